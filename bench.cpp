@@ -0,0 +1,670 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/minealgo.h"
+
+/*
+Benchmarks of the board primitives, the solver and the generators, reported as JSON.
+
+Usage: minealgo_bench [--quick] [--filter <substring>] [--out <file>] [--instrument] [--trace <file>]
+
+- --quick runs few sizes and iterations, as a smoke test.
+- --filter only runs the benchmarks whose name contains the substring.
+- --out writes the JSON to a file instead of stdout.
+- --instrument records the stage times, counters and distributions of ms_instrument.h over the whole run, and adds
+  them to the JSON. Recording slows the measured code down a little.
+- --trace writes the stages of the whole run to a file in the Chrome trace-event format. Mind the size of full runs.
+
+Every input is drawn from fixed seeds, so two runs measure the same work and their JSON can be compared between commits.
+Each case reports latency percentiles, the success rate, and the allocations per operation, counted by the operator new
+below; the generate.attempts cases also report the attempts per operation and the allocations per attempt. Thread
+sweeps report their scaling efficiency: the speedup over one thread, divided by the number of threads.
+*/
+
+namespace {
+	// Allocations made by any thread through operator new.
+	std::atomic<int64_t> allocation_count{0};
+	std::atomic<int64_t> allocated_bytes{0};
+
+	void* Allocate(size_t size, size_t alignment) {
+		allocation_count.fetch_add(1, std::memory_order_relaxed);
+		allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+		void* result;
+		if (alignment <= alignof(std::max_align_t)) {
+			result = std::malloc(size == 0 ? 1 : size);
+		} else {
+			result = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+		}
+		if (result == nullptr) {
+			throw std::bad_alloc();
+		}
+		return result;
+	}
+}
+
+void* operator new(size_t size) {
+	return Allocate(size, 0);
+}
+
+void* operator new[](size_t size) {
+	return Allocate(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+	return Allocate(size, (size_t)alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+	return Allocate(size, (size_t)alignment);
+}
+
+void operator delete(void* pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept {
+	std::free(pointer);
+}
+
+namespace {
+	using ms_algo::Board;
+	using ms_algo::GenerateType;
+	using ms_algo::GridState;
+	using ms_algo::Matrix;
+	using std::vector;
+
+	using Parameters = vector<std::pair<std::string, double>>;
+
+	struct Measurement {
+		std::string name;
+		Parameters parameters;
+		vector<double> nanoseconds;
+		int64_t success_count = 0;
+		int64_t allocation_count = 0;
+		int64_t allocated_bytes = 0;
+
+		// The generation attempts made over all iterations, for the cases that count them. -1 for the others.
+		int64_t attempt_count = -1;
+
+		double Mean() const {
+			double sum = 0;
+			for (double value: nanoseconds) {
+				sum += value;
+			}
+			return nanoseconds.empty() ? 0 : sum / nanoseconds.size();
+		}
+
+		// The nearest-rank percentile. Requires sorted `nanoseconds`.
+		double Percentile(double percent) const {
+			if (nanoseconds.empty()) {
+				return 0;
+			}
+			size_t rank = (size_t)std::ceil(percent / 100 * nanoseconds.size());
+			return nanoseconds[std::min(nanoseconds.size(), std::max<size_t>(rank, 1)) - 1];
+		}
+	};
+
+	struct ScalingPoint {
+		std::string name;
+		int thread_count;
+		double operations_per_second;
+		double efficiency;
+	};
+
+	struct Options {
+		bool quick = false;
+		std::string filter;
+		std::string output_path;
+		bool instrument = false;
+		std::string trace_path;
+
+		// Each case runs until it takes this long, within the bounds on its iterations.
+		double seconds_per_case = 1.0;
+		int max_iterations = 10000;
+	};
+
+	std::string Format(double value) {
+		if (!std::isfinite(value)) {
+			return "null";
+		}
+		std::ostringstream stream;
+		stream.precision(6);
+		stream << value;
+		return stream.str();
+	}
+
+	class Bench {
+	private:
+		Options options_;
+		vector<Measurement> measurements_;
+		vector<ScalingPoint> scaling_;
+
+	public:
+		explicit Bench(const Options& options) : options_(options) {}
+
+		const Options& options() const {
+			return options_;
+		}
+
+		bool Enabled(const std::string& name) const {
+			return options_.filter.empty() || name.find(options_.filter) != std::string::npos;
+		}
+
+		/**
+			Runs `operation(i)` for i = 0, 1, ..., each after an untimed `prepare(i)`, until the case has taken its
+			time or `max_iterations`, and at least `min_iterations` times. `operation` returns whether it succeeded.
+			The region cache is cleared first, so that no case depends on the ones before it.
+		*/
+		template<class Prepare, class Operation>
+		Measurement& Run(const std::string& name, const Parameters& parameters, Prepare prepare, Operation operation,
+			int min_iterations = 3, int max_iterations = 0) {
+			ms_algo::SharedRegionCache().Clear();
+			if (max_iterations == 0) {
+				max_iterations = options_.max_iterations;
+			}
+			Measurement measurement;
+			measurement.name = name;
+			measurement.parameters = parameters;
+			auto beginning = std::chrono::steady_clock::now();
+			for (int iteration = 0; iteration < max_iterations; ++iteration) {
+				double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - beginning).count();
+				if (iteration >= min_iterations && elapsed >= options_.seconds_per_case) {
+					break;
+				}
+				prepare(iteration);
+				int64_t allocations = allocation_count.load(std::memory_order_relaxed);
+				int64_t bytes = allocated_bytes.load(std::memory_order_relaxed);
+				auto start = std::chrono::steady_clock::now();
+				bool success = operation(iteration);
+				auto end = std::chrono::steady_clock::now();
+				measurement.allocation_count += allocation_count.load(std::memory_order_relaxed) - allocations;
+				measurement.allocated_bytes += allocated_bytes.load(std::memory_order_relaxed) - bytes;
+				measurement.success_count += success;
+				measurement.nanoseconds.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+			}
+			std::sort(measurement.nanoseconds.begin(), measurement.nanoseconds.end());
+
+			std::clog << name;
+			for (auto& [key, value]: parameters) {
+				std::clog << ' ' << key << '=' << value;
+			}
+			std::clog << ": " << measurement.nanoseconds.size() << " runs, p50 " << measurement.Percentile(50) / 1000
+				<< " us, success " << measurement.success_count << std::endl;
+			measurements_.push_back(std::move(measurement));
+			return measurements_.back();
+		}
+
+		void AddScaling(const std::string& name, int thread_count, double operations_per_second, double single_thread_operations_per_second) {
+			double efficiency = single_thread_operations_per_second == 0 ? 0
+				: operations_per_second / (single_thread_operations_per_second * thread_count);
+			scaling_.push_back({name, thread_count, operations_per_second, efficiency});
+			std::clog << name << " threads=" << thread_count << ": " << operations_per_second << " ops/s, efficiency "
+				<< efficiency << std::endl;
+		}
+
+		void WriteJson(std::ostream& stream) const {
+			stream << "{\n  \"version\": 1,\n  \"quick\": " << (options_.quick ? "true" : "false")
+				<< ",\n  \"hardware_concurrency\": " << std::thread::hardware_concurrency()
+				<< ",\n  \"bit_board\": " << (ms_algo::kUseBitBoard ? "true" : "false") << ",\n  \"results\": [";
+			for (size_t index = 0; index < measurements_.size(); ++index) {
+				const Measurement& measurement = measurements_[index];
+				double count = measurement.nanoseconds.size();
+				double mean = measurement.Mean();
+				stream << (index == 0 ? "\n" : ",\n") << "    {\"name\": \"" << measurement.name << "\", \"parameters\": {";
+				for (size_t parameter = 0; parameter < measurement.parameters.size(); ++parameter) {
+					stream << (parameter == 0 ? "" : ", ") << '"' << measurement.parameters[parameter].first << "\": "
+						<< Format(measurement.parameters[parameter].second);
+				}
+				stream << "}, \"iterations\": " << measurement.nanoseconds.size()
+					<< ", \"success_rate\": " << Format(count == 0 ? 0 : measurement.success_count / count)
+					<< ", \"mean_ns\": " << Format(mean)
+					<< ", \"p50_ns\": " << Format(measurement.Percentile(50))
+					<< ", \"p90_ns\": " << Format(measurement.Percentile(90))
+					<< ", \"p99_ns\": " << Format(measurement.Percentile(99))
+					<< ", \"max_ns\": " << Format(measurement.Percentile(100))
+					<< ", \"operations_per_second\": " << Format(mean == 0 ? 0 : 1e9 / mean)
+					<< ", \"allocations_per_operation\": " << Format(count == 0 ? 0 : measurement.allocation_count / count)
+					<< ", \"bytes_per_operation\": " << Format(count == 0 ? 0 : measurement.allocated_bytes / count);
+				if (measurement.attempt_count >= 0) {
+					double attempt_count = measurement.attempt_count;
+					stream << ", \"attempts_per_operation\": " << Format(count == 0 ? 0 : attempt_count / count)
+						<< ", \"allocations_per_attempt\": " << Format(attempt_count == 0 ? 0 : measurement.allocation_count / attempt_count);
+				}
+				stream << '}';
+			}
+			stream << "\n  ],\n  \"scaling\": [";
+			for (size_t index = 0; index < scaling_.size(); ++index) {
+				const ScalingPoint& point = scaling_[index];
+				stream << (index == 0 ? "\n" : ",\n") << "    {\"name\": \"" << point.name << "\", \"threads\": " << point.thread_count
+					<< ", \"operations_per_second\": " << Format(point.operations_per_second)
+					<< ", \"efficiency\": " << Format(point.efficiency) << '}';
+			}
+			stream << "\n  ]";
+			if (options_.instrument) {
+				stream << ",\n  \"instrumentation\": ";
+				ms_algo::TakeInstrumentationSnapshot().WriteJson(stream);
+			}
+			stream << "\n}" << std::endl;
+		}
+	};
+
+	struct Size {
+		int row_count;
+		int column_count;
+	};
+
+	int MineCount(const Size& size, double density) {
+		return std::max(1, (int)std::lround(size.row_count * size.column_count * density));
+	}
+
+	Parameters BoardParameters(const Size& size, int mine_count) {
+		return {{"rows", size.row_count}, {"columns", size.column_count}, {"mines", mine_count}};
+	}
+
+	// A random board, and the same board after opening one grid: the first one without mines around, if any.
+	struct Sample {
+		Board board;
+		int open_row;
+		int open_column;
+		Board opened;
+		Matrix<std::pair<GridState, int>> situation;
+	};
+
+	const uint64_t kSeed = 20240601;
+
+	vector<Sample> MakeSamples(const Size& size, int mine_count, int sample_count) {
+		vector<Sample> samples(sample_count);
+		for (int index = 0; index < sample_count; ++index) {
+			Sample& sample = samples[index];
+			int start_row = (size.row_count + 1) / 2, start_column = (size.column_count + 1) / 2;
+			sample.board = ms_algo::Generate(size.row_count, size.column_count, start_row, start_column, GenerateType::kNormal,
+				1000, 1, mine_count, ms_algo::DeriveSeed(kSeed, index)).second;
+			sample.open_row = start_row;
+			sample.open_column = start_column;
+			for (int row = 1; row <= size.row_count && sample.board.get_grid(sample.open_row, sample.open_column).mine_count() != 0; ++row) {
+				for (int column = 1; column <= size.column_count; ++column) {
+					ms_algo::Grid grid = sample.board.get_grid(row, column);
+					if (!grid.is_mine() && grid.mine_count() == 0) {
+						sample.open_row = row;
+						sample.open_column = column;
+						break;
+					}
+				}
+			}
+			sample.opened = sample.board;
+			sample.opened.Open(sample.open_row, sample.open_column);
+			sample.situation = sample.opened.GetSituation();
+		}
+		return samples;
+	}
+
+	// The thread counts of a sweep: powers of two up to the hardware concurrency, and the hardware concurrency itself.
+	vector<int> ThreadCounts(const Options& options) {
+		int max_thread_count = options.quick ? std::min(2, ms_algo::kMaxThreadCount) : ms_algo::kMaxThreadCount;
+		vector<int> result;
+		for (int thread_count = 1; thread_count < max_thread_count; thread_count *= 2) {
+			result.push_back(thread_count);
+		}
+		result.push_back(max_thread_count);
+		return result;
+	}
+
+	void BenchPrimitives(Bench& bench, const vector<Size>& sizes, const vector<double>& densities) {
+		int sample_count = bench.options().quick ? 4 : 16;
+		for (const Size& size: sizes) {
+			for (double density: densities) {
+				int mine_count = MineCount(size, density);
+				vector<Sample> samples = MakeSamples(size, mine_count, sample_count);
+				Parameters parameters = BoardParameters(size, mine_count);
+				auto sample = [&](int iteration) -> Sample& {
+					return samples[iteration % sample_count];
+				};
+				auto nothing = [](int) {};
+
+				if (bench.Enabled("board.refresh")) {
+					Board board;
+					bench.Run("board.refresh", parameters, [&](int iteration) {
+						board = sample(iteration).board;
+					}, [&](int) {
+						board.Refresh();
+						return true;
+					});
+					bench.Run("board.refresh_bitwise", parameters, [&](int iteration) {
+						board = sample(iteration).board;
+					}, [&](int) {
+						ms_algo::RefreshBitwise(board);
+						return true;
+					});
+					// As in the generation attempts, which set the mine plane while placing the mines.
+					ms_algo::BitBoard mines;
+					bench.Run("board.refresh_bitwise_placed", parameters, [&](int iteration) {
+						board = sample(iteration).board;
+						mines.LoadMines(board);
+					}, [&](int) {
+						ms_algo::RefreshBitwise(board, mines);
+						return true;
+					});
+				}
+
+				if (bench.Enabled("board.open")) {
+					Board board;
+					bench.Run("board.open", parameters, [&](int iteration) {
+						board = sample(iteration).board;
+					}, [&](int iteration) {
+						board.Open(sample(iteration).open_row, sample(iteration).open_column);
+						return true;
+					});
+				}
+
+				if (bench.Enabled("region.divide")) {
+					bench.Run("region.divide", parameters, nothing, [&](int iteration) {
+						return !ms_algo::Divide(size.row_count, size.column_count, sample(iteration).situation).empty();
+					});
+				}
+
+				// The regions of every sample, for the elimination and enumeration kernels.
+				vector<ms_algo::Region> regions;
+				for (const Sample& each: samples) {
+					for (auto& region: ms_algo::Divide(size.row_count, size.column_count, each.situation)) {
+						regions.push_back(std::move(region));
+					}
+				}
+				if (!regions.empty() && bench.Enabled("solve.gaussian_elimination")) {
+					ms_algo::SparseMatrix matrix;
+					vector<std::pair<int, int>> solved;
+					bench.Run("solve.gaussian_elimination", parameters, [&](int iteration) {
+						matrix = regions[iteration % regions.size()].second;
+					}, [&](int iteration) {
+						ms_algo::GaussianElimination(matrix, regions[iteration % regions.size()].first.size(), solved);
+						return true;
+					});
+					Matrix<int> dense;
+					bench.Run("solve.gaussian_elimination_dense", parameters, [&](int iteration) {
+						const ms_algo::Region& region = regions[iteration % regions.size()];
+						int variable_count = region.first.size();
+						dense.assign(region.second.size(), vector<int>(variable_count + 1, 0));
+						for (size_t row = 0; row < region.second.size(); ++row) {
+							for (auto [variable, coefficient]: region.second[row].entries) {
+								dense[row][variable] = coefficient;
+							}
+							dense[row][variable_count] = region.second[row].value;
+						}
+					}, [&](int) {
+						ms_algo::GaussianElimination(dense, solved);
+						return true;
+					});
+				}
+
+				if (bench.Enabled("solve.enumerate_mine")) {
+					// Reduced systems with few enough free variables to enumerate in a benchmark.
+					vector<std::pair<ms_algo::SparseMatrix, int>> reduced;
+					for (const ms_algo::Region& region: regions) {
+						ms_algo::SparseMatrix matrix = region.second;
+						int variable_count = region.first.size();
+						vector<std::pair<int, int>> solved;
+						ms_algo::GaussianElimination(matrix, variable_count, solved);
+						if (variable_count - (int)matrix.size() <= 24) {
+							reduced.emplace_back(std::move(matrix), variable_count);
+						}
+					}
+					if (!reduced.empty()) {
+						bench.Run("solve.enumerate_mine", parameters, nothing, [&](int iteration) {
+							auto& [matrix, variable_count] = reduced[iteration % reduced.size()];
+							ms_algo::Timer timer(10000);
+							return ms_algo::EnumerateMine(matrix, variable_count, timer).first > 0;
+						});
+					}
+				}
+
+				if (bench.Enabled("solve.solve_one_step")) {
+					Matrix<std::pair<GridState, int>> situation;
+					bench.Run("solve.solve_one_step", parameters, [&](int iteration) {
+						situation = sample(iteration).situation;
+					}, [&](int) {
+						ms_algo::Timer timer(10000);
+						return ms_algo::SolveOneStep(size.row_count, size.column_count, situation, timer);
+					});
+				}
+
+				if (bench.Enabled("solve.solvable")) {
+					// Random boards, so the success rate is the share of them solvable from the opened grid.
+					bench.Run("solve.solvable", parameters, nothing, [&](int iteration) {
+						return ms_algo::Solvable(sample(iteration).opened, 10000);
+					}, 3, bench.options().quick ? 8 : 1000);
+				}
+			}
+		}
+	}
+
+	void BenchGenerate(Bench& bench, const vector<Size>& sizes, const vector<double>& densities) {
+		const Options& options = bench.options();
+		int time_limit_milliseconds = options.quick ? 2000 : 10000;
+		for (const Size& size: sizes) {
+			int start_row = (size.row_count + 1) / 2, start_column = (size.column_count + 1) / 2;
+			for (double density: densities) {
+				int mine_count = MineCount(size, density);
+				Parameters parameters = BoardParameters(size, mine_count);
+				auto seed = [](int iteration) {
+					return ms_algo::DeriveSeed(kSeed, iteration);
+				};
+
+				if (bench.Enabled("generate.normal")) {
+					bench.Run("generate.normal", parameters, [](int) {}, [&](int iteration) {
+						return ms_algo::Generate(size.row_count, size.column_count, start_row, start_column, GenerateType::kNormal,
+							time_limit_milliseconds, 1, mine_count, seed(iteration)).first;
+					});
+				}
+
+				// Solvable generation gets slow quickly with the density, so large boards take few iterations.
+				int max_iterations = options.quick ? 3 : size.row_count * size.column_count > 1000 ? 10 : 200;
+				const std::pair<const char*, GenerateType> types[] = {
+					{"generate.solvable", GenerateType::kSolvable},
+					{"generate.repair", GenerateType::kRepair},
+					{"generate.constructive", GenerateType::kConstructive},
+				};
+				for (auto [name, type]: types) {
+					if (!bench.Enabled(name)) {
+						continue;
+					}
+					double single_thread_mean = 0;
+					for (int thread_count: type == GenerateType::kSolvable ? ThreadCounts(options) : vector<int>{1}) {
+						Parameters with_threads = parameters;
+						with_threads.emplace_back("threads", thread_count);
+						const Measurement& measurement = bench.Run(name, with_threads, [](int) {}, [&](int iteration) {
+							return ms_algo::Generate(size.row_count, size.column_count, start_row, start_column, type,
+								time_limit_milliseconds, thread_count, mine_count, seed(iteration)).first;
+						}, 1, max_iterations);
+						double mean = measurement.Mean();
+						if (thread_count == 1) {
+							single_thread_mean = mean;
+						}
+						if (type == GenerateType::kSolvable && mean != 0) {
+							std::ostringstream scaling_name;
+							scaling_name << name << ' ' << size.row_count << 'x' << size.column_count << '/' << mine_count;
+							bench.AddScaling(scaling_name.str(), thread_count, 1e9 / mean, single_thread_mean == 0 ? 0 : 1e9 / single_thread_mean);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	/**
+		TryGenerateSolvable() on one thread, called directly so that its attempts can be counted. Untimed calls on other
+		seeds first fill the per-thread buffers and the region cache, so the allocations per attempt are the steady-state
+		ones: region cache misses, and the board returned by each call.
+	*/
+	void BenchAttempts(Bench& bench, const vector<Size>& sizes, const vector<double>& densities) {
+		if (!bench.Enabled("generate.attempts")) {
+			return;
+		}
+		const Options& options = bench.options();
+		int time_limit_milliseconds = options.quick ? 2000 : 10000;
+		for (const Size& size: sizes) {
+			int start_row = (size.row_count + 1) / 2, start_column = (size.column_count + 1) / 2;
+			Board initial_board;
+			vector<std::pair<int, int>> initial_grids;
+			ms_algo::PrepareStart(size.row_count, size.column_count, start_row, start_column, initial_board, initial_grids);
+			for (double density: densities) {
+				int mine_count = MineCount(size, density);
+				int max_iterations = options.quick ? 3 : size.row_count * size.column_count > 1000 ? 10 : 200;
+				int64_t attempt_count = 0;
+				auto generate = [&](uint64_t seed) {
+					ms_algo::SolvableAttempts attempts;
+					ms_algo::Timer timer(time_limit_milliseconds);
+					bool found = ms_algo::TryGenerateSolvable(size.row_count, size.column_count, mine_count, initial_board,
+						initial_grids, seed, attempts, timer).first;
+					attempt_count += attempts.next;
+					return found;
+				};
+				Measurement& measurement = bench.Run("generate.attempts", BoardParameters(size, mine_count), [&](int iteration) {
+					if (iteration == 0) {
+						for (int warm = 0; warm < 3; ++warm) {
+							generate(ms_algo::DeriveSeed(kSeed + 1, warm));
+						}
+						attempt_count = 0;
+					}
+				}, [&](int iteration) {
+					return generate(ms_algo::DeriveSeed(kSeed, iteration));
+				}, 1, max_iterations);
+				measurement.attempt_count = attempt_count;
+				std::clog << "generate.attempts: " << (double)attempt_count / measurement.nanoseconds.size() << " attempts/op, "
+					<< (double)measurement.allocation_count / std::max<int64_t>(attempt_count, 1) << " allocations/attempt" << std::endl;
+			}
+		}
+	}
+
+	// Throughput of GenerateBatch() over thread counts: boards of one spec, each generated on one thread.
+	void BenchBatch(Bench& bench) {
+		if (!bench.Enabled("generate.batch")) {
+			return;
+		}
+		const Options& options = bench.options();
+		ms_algo::GenerateSpec spec;
+		spec.row_count = 16;
+		spec.column_count = 30;
+		spec.start_row = 8;
+		spec.start_column = 15;
+		spec.random_mine_count = 99;
+		spec.time_limit_milliseconds = 10000;
+		int64_t board_count = options.quick ? 8 : 400;
+		double single_thread_rate = 0;
+		for (int thread_count: ThreadCounts(options)) {
+			ms_algo::SharedRegionCache().Clear();
+			ms_algo::BatchOptions batch_options;
+			batch_options.seed = kSeed;
+			batch_options.thread_count = thread_count;
+			ms_algo::BatchStatistics statistics = ms_algo::GenerateBatch({spec}, board_count, [](ms_algo::BatchBoard&&) {
+				return true;
+			}, batch_options);
+			double rate = statistics.BoardsPerSecond();
+			if (thread_count == 1) {
+				single_thread_rate = rate;
+			}
+			bench.AddScaling("generate.batch 16x30/99", thread_count, rate, single_thread_rate);
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	for (int index = 1; index < argc; ++index) {
+		std::string argument = argv[index];
+		if (argument == "--quick") {
+			options.quick = true;
+		} else if (argument == "--filter" && index + 1 < argc) {
+			options.filter = argv[++index];
+		} else if (argument == "--out" && index + 1 < argc) {
+			options.output_path = argv[++index];
+		} else if (argument == "--instrument") {
+			options.instrument = true;
+		} else if (argument == "--trace" && index + 1 < argc) {
+			options.trace_path = argv[++index];
+		} else {
+			std::cerr << "Usage: " << argv[0] << " [--quick] [--filter <substring>] [--out <file>] [--instrument]"
+				" [--trace <file>]" << std::endl;
+			return 2;
+		}
+	}
+	if (options.quick) {
+		options.seconds_per_case = 0.05;
+		options.max_iterations = 50;
+	}
+	ms_algo::SeedThreadRandom(kSeed);
+	ms_algo::SetInstrumentation(options.instrument);
+	ms_algo::SetTracing(!options.trace_path.empty());
+
+	// Sizes from beginner to expert, then large boards, which the quick run leaves out.
+	vector<Size> sizes = {{9, 9}, {16, 16}, {16, 30}, {50, 100}, {100, 200}};
+	vector<double> densities = {0.12, 0.16, 0.2};
+	vector<Size> generate_sizes = {{9, 9}, {16, 16}, {16, 30}, {50, 100}};
+	if (options.quick) {
+		sizes = {{9, 9}, {16, 30}};
+		densities = {0.16};
+		generate_sizes = {{9, 9}, {16, 30}};
+	}
+
+	Bench bench(options);
+	BenchPrimitives(bench, sizes, densities);
+	BenchGenerate(bench, generate_sizes, densities);
+	BenchAttempts(bench, generate_sizes, densities);
+	BenchBatch(bench);
+	ms_algo::SetInstrumentation(false);
+	ms_algo::SetTracing(false);
+
+	if (!options.trace_path.empty()) {
+		std::ofstream stream(options.trace_path);
+		ms_algo::WriteChromeTrace(stream);
+		if (!stream) {
+			std::cerr << "Cannot write " << options.trace_path << std::endl;
+			return 1;
+		}
+	}
+	if (options.output_path.empty()) {
+		bench.WriteJson(std::cout);
+	} else {
+		std::ofstream stream(options.output_path);
+		bench.WriteJson(stream);
+		if (!stream) {
+			std::cerr << "Cannot write " << options.output_path << std::endl;
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -1,11 +1,24 @@
-#ifndef _MINEALGO_H
-#define _MINEALGO_H
-
-#include "ms_board.h"
-#include "ms_generate.h"
-#include "ms_grid.h"
-#include "ms_lib.h"
-#include "ms_solve.h"
-#include "ms_timer.h"
-
-#endif
+#ifndef _MINEALGO_H
+#define _MINEALGO_H
+
+#include "ms_batch.h"
+#include "ms_bigint.h"
+#include "ms_bitboard.h"
+#include "ms_board.h"
+#include "ms_cache.h"
+#include "ms_corpus.h"
+#include "ms_count.h"
+#include "ms_generate.h"
+#include "ms_grid.h"
+#include "ms_instrument.h"
+#include "ms_lib.h"
+#include "ms_pattern.h"
+#include "ms_pool.h"
+#include "ms_probability.h"
+#include "ms_queue.h"
+#include "ms_region.h"
+#include "ms_solve.h"
+#include "ms_thread_pool.h"
+#include "ms_timer.h"
+
+#endif
@@ -0,0 +1,441 @@
+#ifndef MINEALGO_MS_BATCH_H_
+#define MINEALGO_MS_BATCH_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "ms_board.h"
+#include "ms_generate.h"
+#include "ms_queue.h"
+#include "ms_thread_pool.h"
+#include "ms_timer.h"
+
+namespace ms_algo {
+    using std::vector;
+
+    // One configuration of a batch, with the meaning of the arguments of Generate() by starting position.
+    struct GenerateSpec {
+        int row_count = 16;
+        int column_count = 30;
+
+        // The starting position guaranteed not to be mine. 0 draws one for each board, as Generate() does.
+        int start_row = 0;
+        int start_column = 0;
+
+        // 0 for the default of Generate().
+        int random_mine_count = 0;
+
+        GenerateType type = GenerateType::kSolvable;
+
+        // The time limit of each board. A board not found in time counts as a failure and is tried again with the next seed.
+        int time_limit_milliseconds = 1000;
+    };
+
+    // A board produced by a batch, with the index of the spec it follows.
+    struct BatchBoard {
+        int spec_index = -1;
+        Board board;
+    };
+
+    // Receives the boards of a batch, from any worker at once. Returning false stops the batch.
+    using BatchSink = std::function<bool(BatchBoard&&)>;
+
+    struct BatchOptions {
+        // The number of tasks producing boards on SharedThreadPool(). Each produces one board at a time.
+        int thread_count = kMaxThreadCount;
+
+        // The seed of the batch, or 0 for a fresh one from NewSeed().
+        uint64_t seed = 0;
+
+        // The time limit of the whole batch, or 0 for none. Boards cut short by it are not counted as failures.
+        int64_t time_limit_milliseconds = 0;
+
+        // A spec gives up after this many failures, so that a spec with no solvable board does not hold the batch.
+        int64_t max_failure_count = std::numeric_limits<int64_t>::max();
+    };
+
+    struct SpecStatistics {
+        // The mine count used, after the default of Generate() is applied.
+        int random_mine_count = 0;
+
+        // Boards passed to the sink.
+        int64_t board_count = 0;
+
+        // Boards not found within the time limit of the spec.
+        int64_t failure_count = 0;
+
+        // Candidate boards tried, over both.
+        int64_t attempt_count = 0;
+
+        // Time spent by the workers producing boards of this spec, the sink excluded.
+        int64_t busy_microseconds = 0;
+
+        double FailureRate() const {
+            int64_t total = board_count + failure_count;
+            return total == 0 ? 0.0 : (double)failure_count / total;
+        }
+
+        // The cost of one board on one thread.
+        double MicrosecondsPerBoard() const {
+            return board_count == 0 ? 0.0 : (double)busy_microseconds / board_count;
+        }
+    };
+
+    struct BatchStatistics {
+        // In the order of the specs.
+        vector<SpecStatistics> specs;
+
+        uint64_t seed = 0;
+
+        int64_t elapsed_microseconds = 0;
+
+        // Whether the batch ended before every spec had its boards or gave up: by the sink or the time limit.
+        bool stopped = false;
+
+        int64_t board_count() const {
+            int64_t result = 0;
+            for (const SpecStatistics& spec: specs) {
+                result += spec.board_count;
+            }
+            return result;
+        }
+
+        // Boards per second of wall time, over all specs or for one of them.
+        double BoardsPerSecond() const {
+            return elapsed_microseconds == 0 ? 0.0 : board_count() * 1e6 / elapsed_microseconds;
+        }
+
+        double BoardsPerSecond(int spec_index) const {
+            return elapsed_microseconds == 0 ? 0.0 : specs[spec_index].board_count * 1e6 / elapsed_microseconds;
+        }
+
+        void Print(std::ostream& stream) const {
+            stream << std::fixed << std::setprecision(2);
+            for (size_t index = 0; index < specs.size(); ++index) {
+                const SpecStatistics& spec = specs[index];
+                stream << "spec " << index << ": " << spec.board_count << " boards, " << spec.failure_count
+                    << " failures (" << spec.FailureRate() * 100 << "%), " << spec.attempt_count << " attempts, "
+                    << spec.MicrosecondsPerBoard() / 1000 << " ms/board, " << BoardsPerSecond(index) << " boards/s" << std::endl;
+            }
+            stream << "total: " << board_count() << " boards in " << elapsed_microseconds / 1e6 << " s, "
+                << BoardsPerSecond() << " boards/s" << (stopped ? " (stopped)" : "") << std::endl;
+            stream << std::defaultfloat;
+        }
+    };
+
+    // Opens the starting grid of an empty board and lists the other grids as mine candidates, in the order of GenerateSolvable().
+    void PrepareStart(int row_count, int column_count, int start_row, int start_column, Board& board, vector<std::pair<int, int>>& grids) {
+        board.Resize(row_count, column_count);
+        board.get_grid_ref(start_row, start_column).set_state(GridState::kOpened);
+        grids.clear();
+        for (int row = 1; row <= row_count; ++row) {
+            for (int column = 1; column <= column_count; ++column) {
+                if (row != start_row || column != start_column) {
+                    grids.emplace_back(row, column);
+                }
+            }
+        }
+    }
+
+    // The state of a running batch, shared by its tasks. The last task to finish fulfills `promise`.
+    struct BatchState {
+        struct Spec {
+            GenerateSpec spec;
+            int random_mine_count;
+            uint64_t seed;
+
+            // Prepared once for a fixed starting position.
+            Board initial_board;
+            vector<std::pair<int, int>> initial_grids;
+
+            // The number of the next board. Board `i` is generated with DeriveSeed(seed, i).
+            std::atomic<uint64_t> next{0};
+
+            // Boards delivered or in progress. No board is started once it reaches the target.
+            std::atomic<int64_t> reserved{0};
+
+            std::atomic<int64_t> board_count{0};
+            std::atomic<int64_t> failure_count{0};
+            std::atomic<int64_t> attempt_count{0};
+            std::atomic<int64_t> busy_microseconds{0};
+        };
+
+        vector<std::unique_ptr<Spec>> specs;
+        int64_t target_count;
+        int64_t max_failure_count;
+        int64_t deadline;
+        uint64_t seed;
+        int64_t beginning_microseconds;
+
+        BatchSink sink;
+        std::function<void()> on_finish;
+
+        std::atomic_bool stopping{false};
+        std::atomic<int> running{0};
+        std::promise<BatchStatistics> promise;
+
+        // Claims a board of a spec. Returns false if the spec has all of its boards or gave up.
+        bool Reserve(Spec& spec) {
+            int64_t current = spec.reserved;
+            while (current < target_count && spec.failure_count < max_failure_count) {
+                if (spec.reserved.compare_exchange_weak(current, current + 1)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void Finish() {
+            BatchStatistics statistics;
+            statistics.seed = seed;
+            statistics.elapsed_microseconds = GetMicroseconds() - beginning_microseconds;
+            statistics.stopped = stopping;
+            for (auto& spec: specs) {
+                SpecStatistics& result = statistics.specs.emplace_back();
+                result.random_mine_count = spec->random_mine_count;
+                result.board_count = spec->board_count;
+                result.failure_count = spec->failure_count;
+                result.attempt_count = spec->attempt_count;
+                result.busy_microseconds = spec->busy_microseconds;
+            }
+            if (on_finish) {
+                on_finish();
+            }
+            promise.set_value(std::move(statistics));
+        }
+    };
+
+    // The mine count of a spec, after the default of Generate() is applied.
+    int SpecMineCount(const GenerateSpec& config) {
+        int max_random_mine_count = config.row_count * config.column_count - 1;
+        return config.random_mine_count != 0 ? config.random_mine_count
+            : std::min(int(config.row_count * config.column_count * 0.15), max_random_mine_count / 4);
+    }
+
+    /**
+        @brief (Do not call this function directly) Generates one board of a spec on the current thread.
+        @param initial_board, initial_grids The spec prepared by PrepareStart(), used when its starting position is fixed.
+        @param timer The time limit. Unused by `kNormal`, which may pass nullptr.
+        @param attempt_count Incremented by the number of candidate boards tried.
+
+        Runs the attempt loops of Generate(), which keep their board and solver per thread, and prepares a drawn starting
+        position in per-thread buffers, so a board allocates nothing but itself. The board is the one Generate() by
+        starting position gives on one thread with `seed`.
+    */
+    std::pair<bool, Board> GenerateFromSpec(
+        const GenerateSpec& config,
+        int random_mine_count,
+        uint64_t seed,
+        const Board* initial_board,
+        const vector<std::pair<int, int>>* initial_grids,
+        Timer* timer,
+        int64_t& attempt_count
+    ) {
+        static thread_local Board drawn_board;
+        static thread_local vector<std::pair<int, int>> drawn_grids;
+        static thread_local vector<std::pair<int, int>> grids;
+
+        if (config.start_row == 0 || config.start_column == 0) {
+            Xoshiro256 start_generator(DeriveSeed(seed, ~0ULL));
+            int start_row = config.start_row, start_column = config.start_column;
+            if (start_row == 0) {
+                start_row = start_generator.Below(config.row_count) + 1;
+            }
+            if (start_column == 0) {
+                start_column = start_generator.Below(config.column_count) + 1;
+            }
+            PrepareStart(config.row_count, config.column_count, start_row, start_column, drawn_board, drawn_grids);
+            initial_board = &drawn_board;
+            initial_grids = &drawn_grids;
+        }
+
+        std::pair<bool, Board> found;
+        if (config.type == GenerateType::kNormal) {
+            // As GenerateNormal(): the mines avoid the starting grid, which is left unopened.
+            found.second.Resize(config.row_count, config.column_count);
+            grids = *initial_grids;
+            PlaceRandomMines(found.second, grids, random_mine_count, seed);
+            RefreshMineCounts(found.second);
+            found.first = true;
+            ++attempt_count;
+        } else {
+            SolvableAttempts attempts;
+            auto try_generate = config.type == GenerateType::kRepair ? TryGenerateRepaired
+                : config.type == GenerateType::kConstructive ? TryGenerateConstructive : TryGenerateSolvable;
+            found = try_generate(config.row_count, config.column_count, random_mine_count, *initial_board, *initial_grids, seed, attempts, *timer);
+            attempt_count += attempts.next;
+        }
+        return found;
+    }
+
+    /**
+        @brief (Do not call this function directly) Produces boards of a batch until none is left to claim.
+        Visits the specs in turn from `worker`, so that every spec makes progress while the batch streams, and produces
+        each board on one thread with GenerateFromSpec().
+    */
+    void RunBatchWorker(BatchState& state, int worker) {
+        int spec_count = state.specs.size();
+        int cursor = spec_count == 0 ? 0 : worker % spec_count;
+        while (!state.stopping && spec_count != 0) {
+            if (GetMilliseconds() >= state.deadline) {
+                state.stopping = true;
+                break;
+            }
+            int spec_index = -1;
+            for (int offset = 0; offset < spec_count; ++offset) {
+                int index = (cursor + offset) % spec_count;
+                if (state.Reserve(*state.specs[index])) {
+                    spec_index = index;
+                    break;
+                }
+            }
+            if (spec_index == -1) {
+                break;
+            }
+            cursor = (spec_index + 1) % spec_count;
+
+            BatchState::Spec& spec = *state.specs[spec_index];
+            const GenerateSpec& config = spec.spec;
+            uint64_t seed = DeriveSeed(spec.seed, spec.next++);
+            int64_t beginning = GetMicroseconds();
+            int64_t attempt_count = 0;
+
+            std::pair<bool, Board> found;
+            bool cut_short = false;
+            if (config.type == GenerateType::kNormal) {
+                found = GenerateFromSpec(config, spec.random_mine_count, seed, &spec.initial_board, &spec.initial_grids, nullptr, attempt_count);
+            } else {
+                int64_t remaining = state.deadline - GetMilliseconds();
+                int time_limit_milliseconds = std::max<int64_t>(1, std::min<int64_t>(config.time_limit_milliseconds, remaining));
+                cut_short = time_limit_milliseconds < config.time_limit_milliseconds;
+                Timer timer(time_limit_milliseconds);
+                found = GenerateFromSpec(config, spec.random_mine_count, seed, &spec.initial_board, &spec.initial_grids, &timer, attempt_count);
+            }
+            spec.attempt_count += attempt_count;
+            spec.busy_microseconds += GetMicroseconds() - beginning;
+
+            if (!found.first) {
+                --spec.reserved;
+                if (!cut_short) {
+                    ++spec.failure_count;
+                }
+                continue;
+            }
+            if (state.stopping) {
+                break;
+            }
+            ++spec.board_count;
+            if (!state.sink({spec_index, std::move(found.second)})) {
+                state.stopping = true;
+            }
+        }
+    }
+
+    /**
+        @brief Starts producing `target_count` boards of each spec on SharedThreadPool(), and returns at once.
+        @param sink Receives each board as soon as it is found, from the worker that found it, so it must be thread-safe.
+            Workers wait for it, which holds production back when it falls behind.
+        @param on_finish Called once after the last board, before the future is ready.
+        @return The future of the statistics, ready when every spec has its boards or gave up, or the batch stopped.
+            From a worker of the pool, wait for it with ThreadPool::Wait(), which runs other tasks meanwhile.
+
+        The specs are prepared once for the whole batch, and each of the `options.thread_count` tasks produces boards
+        one at a time until none is left, so threads do not wait for each other between boards. Board `i` of spec `s`
+        is tried with the seed DeriveSeed(DeriveSeed(seed, s), i), and boards that fail move on to the next number, so
+        the boards of a batch only depend on its seed unless some time out. Like other boards, each one records the seed
+        of its mines in Board::seed(), and for `kNormal` and `kSolvable`, Generate() by starting position gives it again
+        from that seed and its starting position.
+    */
+    std::future<BatchStatistics> StartBatch(
+        const vector<GenerateSpec>& specs,
+        int64_t target_count,
+        BatchSink sink,
+        const BatchOptions& options = BatchOptions(),
+        std::function<void()> on_finish = nullptr
+    ) {
+        assert(target_count >= 0);
+        assert(options.thread_count >= 1);
+        assert(options.time_limit_milliseconds >= 0);
+
+        auto state = std::make_shared<BatchState>();
+        state->beginning_microseconds = GetMicroseconds();
+        state->target_count = target_count;
+        state->max_failure_count = options.max_failure_count;
+        state->deadline = options.time_limit_milliseconds == 0 ? std::numeric_limits<int64_t>::max()
+            : GetMilliseconds() + options.time_limit_milliseconds;
+        state->seed = options.seed == 0 ? NewSeed() : options.seed;
+        state->sink = std::move(sink);
+        state->on_finish = std::move(on_finish);
+
+        for (size_t index = 0; index < specs.size(); ++index) {
+            const GenerateSpec& config = specs[index];
+            assert(1 <= config.row_count && config.row_count <= kMaxRowCount);
+            assert(1 <= config.column_count && config.column_count <= kMaxColumnCount);
+            assert(0 <= config.start_row && config.start_row <= config.row_count);
+            assert(0 <= config.start_column && config.start_column <= config.column_count);
+            assert(1 <= config.time_limit_milliseconds && config.time_limit_milliseconds <= kMaxTimeLimitMilliseconds);
+
+            auto& spec = state->specs.emplace_back(std::make_unique<BatchState::Spec>());
+            spec->spec = config;
+            spec->seed = DeriveSeed(state->seed, index);
+            spec->random_mine_count = SpecMineCount(config);
+            assert(0 <= spec->random_mine_count && spec->random_mine_count < config.row_count * config.column_count);
+            if (config.start_row != 0 && config.start_column != 0) {
+                PrepareStart(config.row_count, config.column_count, config.start_row, config.start_column,
+                    spec->initial_board, spec->initial_grids);
+            }
+        }
+
+        std::future<BatchStatistics> result = state->promise.get_future();
+        state->running = options.thread_count;
+        ThreadPool& pool = SharedThreadPool();
+        for (int worker = 0; worker < options.thread_count; ++worker) {
+            pool.Execute([state, worker] {
+                RunBatchWorker(*state, worker);
+                if (--state->running == 0) {
+                    state->Finish();
+                }
+            });
+        }
+        return result;
+    }
+
+    // Starts a batch streaming into a queue, which is closed after the last board. Closing it earlier stops the batch.
+    // The queue must outlive the batch.
+    std::future<BatchStatistics> StartBatch(
+        const vector<GenerateSpec>& specs,
+        int64_t target_count,
+        BoundedQueue<BatchBoard>& queue,
+        const BatchOptions& options = BatchOptions()
+    ) {
+        return StartBatch(specs, target_count, [&queue](BatchBoard&& board) {
+            return queue.Push(std::move(board));
+        }, options, [&queue] {
+            queue.Close();
+        });
+    }
+
+    // Produces `target_count` boards of each spec, passing them to `sink`, and returns the statistics. See StartBatch().
+    BatchStatistics GenerateBatch(
+        const vector<GenerateSpec>& specs,
+        int64_t target_count,
+        BatchSink sink,
+        const BatchOptions& options = BatchOptions()
+    ) {
+        std::future<BatchStatistics> result = StartBatch(specs, target_count, std::move(sink), options);
+        SharedThreadPool().Wait(result);
+        return result.get();
+    }
+}
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef MINEALGO_MS_BIGINT_H_
+#define MINEALGO_MS_BIGINT_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ms_algo {
+    using std::vector;
+
+    // An unsigned integer of arbitrary size, for exact solution counts.
+    class BigUnsigned {
+    private:
+        // 32-bit limbs, least significant first, without leading zero limbs.
+        vector<uint32_t> limbs_;
+
+        void Trim() {
+            while (!limbs_.empty() && limbs_.back() == 0) {
+                limbs_.pop_back();
+            }
+        }
+
+    public:
+        BigUnsigned(uint64_t value = 0) {
+            while (value != 0) {
+                limbs_.push_back((uint32_t)value);
+                value >>= 32;
+            }
+        }
+
+        bool IsZero() const {
+            return limbs_.empty();
+        }
+
+        BigUnsigned& operator+=(const BigUnsigned& rhs) {
+            if (limbs_.size() < rhs.limbs_.size()) {
+                limbs_.resize(rhs.limbs_.size(), 0);
+            }
+            uint64_t carry = 0;
+            for (size_t index = 0; index < limbs_.size(); ++index) {
+                carry += (uint64_t)limbs_[index] + (index < rhs.limbs_.size() ? rhs.limbs_[index] : 0);
+                limbs_[index] = (uint32_t)carry;
+                carry >>= 32;
+                if (carry == 0 && index >= rhs.limbs_.size()) {
+                    break;
+                }
+            }
+            if (carry != 0) {
+                limbs_.push_back((uint32_t)carry);
+            }
+            return *this;
+        }
+
+        // Subtracts a value not greater than this one.
+        BigUnsigned& operator-=(const BigUnsigned& rhs) {
+            assert(!(*this < rhs));
+            int64_t borrow = 0;
+            for (size_t index = 0; index < limbs_.size(); ++index) {
+                int64_t value = (int64_t)limbs_[index] - (index < rhs.limbs_.size() ? rhs.limbs_[index] : 0) - borrow;
+                borrow = value < 0;
+                limbs_[index] = (uint32_t)(value + (borrow << 32));
+                if (borrow == 0 && index >= rhs.limbs_.size()) {
+                    break;
+                }
+            }
+            Trim();
+            return *this;
+        }
+
+        friend BigUnsigned operator+(BigUnsigned lhs, const BigUnsigned& rhs) {
+            lhs += rhs;
+            return lhs;
+        }
+
+        friend BigUnsigned operator-(BigUnsigned lhs, const BigUnsigned& rhs) {
+            lhs -= rhs;
+            return lhs;
+        }
+
+        friend BigUnsigned operator*(const BigUnsigned& lhs, const BigUnsigned& rhs) {
+            BigUnsigned result;
+            if (lhs.IsZero() || rhs.IsZero()) {
+                return result;
+            }
+            result.limbs_.assign(lhs.limbs_.size() + rhs.limbs_.size(), 0);
+            for (size_t i = 0; i < lhs.limbs_.size(); ++i) {
+                uint64_t carry = 0;
+                for (size_t j = 0; j < rhs.limbs_.size(); ++j) {
+                    carry += (uint64_t)lhs.limbs_[i] * rhs.limbs_[j] + result.limbs_[i + j];
+                    result.limbs_[i + j] = (uint32_t)carry;
+                    carry >>= 32;
+                }
+                result.limbs_[i + rhs.limbs_.size()] = (uint32_t)carry;
+            }
+            result.Trim();
+            return result;
+        }
+
+        BigUnsigned& operator*=(const BigUnsigned& rhs) {
+            *this = *this * rhs;
+            return *this;
+        }
+
+        // Divides by a small number and returns the remainder.
+        uint32_t DivideSmall(uint32_t divisor) {
+            assert(divisor != 0);
+            uint64_t remainder = 0;
+            for (size_t index = limbs_.size(); index-- > 0;) {
+                uint64_t current = remainder << 32 | limbs_[index];
+                limbs_[index] = (uint32_t)(current / divisor);
+                remainder = current % divisor;
+            }
+            Trim();
+            return remainder;
+        }
+
+        friend bool operator==(const BigUnsigned& lhs, const BigUnsigned& rhs) {
+            return lhs.limbs_ == rhs.limbs_;
+        }
+
+        friend bool operator!=(const BigUnsigned& lhs, const BigUnsigned& rhs) {
+            return lhs.limbs_ != rhs.limbs_;
+        }
+
+        friend bool operator<(const BigUnsigned& lhs, const BigUnsigned& rhs) {
+            if (lhs.limbs_.size() != rhs.limbs_.size()) {
+                return lhs.limbs_.size() < rhs.limbs_.size();
+            }
+            return std::lexicographical_compare(lhs.limbs_.rbegin(), lhs.limbs_.rend(), rhs.limbs_.rbegin(), rhs.limbs_.rend());
+        }
+
+        // Returns the value as a double, or +inf beyond its range.
+        double ToDouble() const {
+            double result = 0;
+            for (size_t index = limbs_.size(); index-- > 0;) {
+                result = result * 4294967296.0 + limbs_[index];
+            }
+            return result;
+        }
+
+        // Returns lhs / rhs as a double, accurate even when both are beyond the range of double.
+        friend double Ratio(const BigUnsigned& lhs, const BigUnsigned& rhs) {
+            assert(!rhs.IsZero());
+            int shift = (int)std::max(lhs.limbs_.size(), rhs.limbs_.size()) - 8;
+            if (shift <= 0) {
+                return lhs.ToDouble() / rhs.ToDouble();
+            }
+            auto top = [shift](const BigUnsigned& value) {
+                double result = 0;
+                for (size_t index = value.limbs_.size(); index-- > (size_t)shift;) {
+                    result = result * 4294967296.0 + value.limbs_[index];
+                }
+                return result;
+            };
+            return top(lhs) / top(rhs);
+        }
+
+        std::string ToString() const {
+            if (IsZero()) {
+                return "0";
+            }
+            BigUnsigned value(*this);
+            std::string result;
+            while (!value.IsZero()) {
+                result.push_back('0' + value.DivideSmall(10));
+            }
+            std::reverse(result.begin(), result.end());
+            return result;
+        }
+    };
+}
+
+#endif
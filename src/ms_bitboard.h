@@ -0,0 +1,467 @@
+#ifndef MINEALGO_MS_BITBOARD_H_
+#define MINEALGO_MS_BITBOARD_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "ms_board.h"
+#include "ms_grid.h"
+#include "ms_instrument.h"
+#include "ms_lib.h"
+
+namespace ms_algo {
+    using std::vector;
+
+    // Adds one bit plane into a bit-sliced 4-bit counter.
+    void AddPlane(uint64_t plane, uint64_t& bit0, uint64_t& bit1, uint64_t& bit2, uint64_t& bit3) {
+        uint64_t carry0 = bit0 & plane;
+        bit0 ^= plane;
+        uint64_t carry1 = bit1 & carry0;
+        bit1 ^= carry0;
+        uint64_t carry2 = bit2 & carry1;
+        bit2 ^= carry1;
+        bit3 |= carry2;
+    }
+
+#ifdef __AVX2__
+    void AddPlane(__m256i plane, __m256i& bit0, __m256i& bit1, __m256i& bit2, __m256i& bit3) {
+        __m256i carry0 = _mm256_and_si256(bit0, plane);
+        bit0 = _mm256_xor_si256(bit0, plane);
+        __m256i carry1 = _mm256_and_si256(bit1, carry0);
+        bit1 = _mm256_xor_si256(bit1, carry0);
+        __m256i carry2 = _mm256_and_si256(bit2, carry1);
+        bit2 = _mm256_xor_si256(bit2, carry1);
+        bit3 = _mm256_or_si256(bit3, carry2);
+    }
+#endif
+
+    // Sums 8 bit planes of `word_count` words into 4 bit planes, one bit of the count each.
+    void SumPlanes(const uint64_t* const planes[8], uint64_t* const sums[4], int word_count) {
+        int word = 0;
+#ifdef __AVX2__
+        for (; word + 4 <= word_count; word += 4) {
+            __m256i bit0 = _mm256_setzero_si256();
+            __m256i bit1 = _mm256_setzero_si256();
+            __m256i bit2 = _mm256_setzero_si256();
+            __m256i bit3 = _mm256_setzero_si256();
+            for (int index = 0; index < 8; ++index) {
+                __m256i plane = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(planes[index] + word));
+                AddPlane(plane, bit0, bit1, bit2, bit3);
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums[0] + word), bit0);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums[1] + word), bit1);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums[2] + word), bit2);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums[3] + word), bit3);
+        }
+#endif
+        for (; word < word_count; ++word) {
+            uint64_t bit0 = 0, bit1 = 0, bit2 = 0, bit3 = 0;
+            for (int index = 0; index < 8; ++index) {
+                AddPlane(planes[index][word], bit0, bit1, bit2, bit3);
+            }
+            sums[0][word] = bit0;
+            sums[1][word] = bit1;
+            sums[2][word] = bit2;
+            sums[3][word] = bit3;
+        }
+    }
+
+    // Packs the lowest bits of the 8 bytes of `bytes` into a byte: byte `k` gives bit `k`.
+    uint64_t GatherLowBits(uint64_t bytes) {
+        return (bytes & 0x0101010101010101) * 0x0102040810204080 >> 56;
+    }
+
+    // The reverse of GatherLowBits(): bit `k` of the lowest byte of `bits` becomes the lowest bit of byte `k`.
+    uint64_t SpreadLowBits(uint64_t bits) {
+        uint64_t selected = (bits & 0xff) * 0x0101010101010101 & 0x8040201008040201;
+        return (selected + 0x7f7f7f7f7f7f7f7f) >> 7 & 0x0101010101010101;
+    }
+
+    // Reads `count` (at most 8) grids as the bytes of a word, the first grid lowest, as on the little-endian hosts the
+    // library is meant for. The other bytes are 0.
+    uint64_t LoadGrids(const Grid* grids, int count) {
+        uint64_t result = 0;
+        std::memcpy(&result, reinterpret_cast<const uint8_t*>(grids), count);
+        return result;
+    }
+
+    // Writes the lowest `count` bytes of a word back as grids, as LoadGrids() reads them.
+    void StoreGrids(uint64_t bytes, Grid* grids, int count) {
+        std::memcpy(reinterpret_cast<uint8_t*>(grids), &bytes, count);
+    }
+
+    // The game board as per-row bit planes.
+    // Column `c` of a row is bit `c - 1` of the row's words; rows 0 and `row_count + 1` are empty padding.
+    class BitBoard {
+    private:
+        int row_count_;
+
+        int column_count_;
+
+        // The number of 64-bit words per row.
+        int word_count_;
+
+        // The valid bits of the last word in a row.
+        uint64_t last_word_mask_;
+
+        vector<uint64_t> mines_;
+
+        vector<uint64_t> opened_;
+
+        vector<uint64_t> flaged_;
+
+        // Bit planes of the number of mines around each grid, least significant first.
+        vector<uint64_t> mine_counts_[4];
+
+        // Scratch planes shifted by one column, and of unknown grids.
+        vector<uint64_t> shifted_left_;
+        vector<uint64_t> shifted_right_;
+        vector<uint64_t> unknown_;
+
+        // Moves every bit towards higher columns: bit `c` receives column `c - 1`.
+        void ShiftLeft(const uint64_t* source, uint64_t* target) const {
+            uint64_t carry = 0;
+            for (int word = 0; word < word_count_; ++word) {
+                target[word] = source[word] << 1 | carry;
+                carry = source[word] >> 63;
+            }
+            target[word_count_ - 1] &= last_word_mask_;
+        }
+
+        // Moves every bit towards lower columns: bit `c` receives column `c + 1`.
+        void ShiftRight(const uint64_t* source, uint64_t* target) const {
+            for (int word = 0; word < word_count_; ++word) {
+                uint64_t carry = word + 1 < word_count_ ? source[word + 1] << 63 : 0;
+                target[word] = source[word] >> 1 | carry;
+            }
+        }
+
+        size_t Offset(int row) const {
+            return (size_t)row * word_count_;
+        }
+
+        static void SetBit(vector<uint64_t>& plane, size_t offset, int column, bool value) {
+            uint64_t mask = uint64_t(1) << ((column - 1) & 63);
+            uint64_t& word = plane[offset + ((column - 1) >> 6)];
+            word = value ? word | mask : word & ~mask;
+        }
+
+        static bool GetBit(const vector<uint64_t>& plane, size_t offset, int column) {
+            return plane[offset + ((column - 1) >> 6)] >> ((column - 1) & 63) & 1;
+        }
+
+    public:
+        void Resize(const int row_count, const int column_count) {
+            assert(1 <= row_count && row_count <= kMaxRowCount);
+            assert(1 <= column_count && column_count <= kMaxColumnCount);
+            row_count_ = row_count;
+            column_count_ = column_count;
+            word_count_ = (column_count + 63) / 64;
+            last_word_mask_ = column_count % 64 == 0 ? ~uint64_t(0) : (uint64_t(1) << (column_count % 64)) - 1;
+
+            size_t size = Offset(row_count + 2);
+            mines_.assign(size, 0);
+            opened_.assign(size, 0);
+            flaged_.assign(size, 0);
+            for (auto& plane: mine_counts_) {
+                plane.assign(size, 0);
+            }
+            shifted_left_.assign(size, 0);
+            shifted_right_.assign(size, 0);
+            unknown_.assign(size, 0);
+        }
+
+        int row_count() const {
+            return row_count_;
+        }
+
+        int column_count() const {
+            return column_count_;
+        }
+
+        int word_count() const {
+            return word_count_;
+        }
+
+        // Loads mines and states from a board, 8 grids at a time.
+        void Assign(const Board& board) {
+            if (board.row_count() != row_count_ || board.column_count() != column_count_) {
+                Resize(board.row_count(), board.column_count());
+            }
+            for (int row = 1; row <= row_count_; ++row) {
+                const Grid* grids = board.cells().data() + board.Index(row, 1);
+                size_t offset = Offset(row);
+                for (int word = 0; word < word_count_; ++word) {
+                    uint64_t mine_word = 0, opened_word = 0, flaged_word = 0;
+                    int bit_count = std::min(64, column_count_ - word * 64);
+                    for (int bit = 0; bit < bit_count; bit += 8) {
+                        uint64_t bytes = LoadGrids(grids + word * 64 + bit, std::min(8, bit_count - bit));
+                        // Bit 0 is the mine, and bits 5-6 the state: 01 for opened, 10 for flaged.
+                        mine_word |= GatherLowBits(bytes) << bit;
+                        opened_word |= GatherLowBits(bytes >> 5 & ~(bytes >> 6)) << bit;
+                        flaged_word |= GatherLowBits(bytes >> 6 & ~(bytes >> 5)) << bit;
+                    }
+                    mines_[offset + word] = mine_word;
+                    opened_[offset + word] = opened_word;
+                    flaged_[offset + word] = flaged_word;
+                }
+            }
+        }
+
+        // Loads only the mines of a board, 8 grids at a time.
+        void LoadMines(const Board& board) {
+            if (board.row_count() != row_count_ || board.column_count() != column_count_) {
+                Resize(board.row_count(), board.column_count());
+            }
+            for (int row = 1; row <= row_count_; ++row) {
+                const Grid* grids = board.cells().data() + board.Index(row, 1);
+                size_t offset = Offset(row);
+                for (int word = 0; word < word_count_; ++word) {
+                    uint64_t mine_word = 0;
+                    int bit_count = std::min(64, column_count_ - word * 64);
+                    for (int bit = 0; bit < bit_count; bit += 8) {
+                        mine_word |= GatherLowBits(LoadGrids(grids + word * 64 + bit, std::min(8, bit_count - bit))) << bit;
+                    }
+                    mines_[offset + word] = mine_word;
+                }
+            }
+        }
+
+        // The mine plane, with the padding rows.
+        const vector<uint64_t>& mines() const {
+            return mines_;
+        }
+
+        // Replaces the mine plane with one taken from mines() of a bit board of the given size.
+        void set_mines(int row_count, int column_count, const vector<uint64_t>& mines) {
+            if (row_count != row_count_ || column_count != column_count_) {
+                Resize(row_count, column_count);
+            }
+            assert(mines.size() == mines_.size());
+            std::copy(mines.begin(), mines.end(), mines_.begin());
+        }
+
+        // Loads states from a situation returned by Board::GetSituation(). Mines are cleared.
+        void Assign(int row_count, int column_count, const Matrix<std::pair<GridState, int>>& states) {
+            Resize(row_count, column_count);
+            for (int row = 1; row <= row_count_; ++row) {
+                size_t offset = Offset(row);
+                for (int column = 1; column <= column_count_; ++column) {
+                    SetBit(opened_, offset, column, states[row][column].first == GridState::kOpened);
+                    SetBit(flaged_, offset, column, states[row][column].first == GridState::kFlaged);
+                }
+            }
+        }
+
+        bool is_mine(int row, int column) const {
+            assert(Inside(row, column, row_count_, column_count_));
+            return GetBit(mines_, Offset(row), column);
+        }
+
+        void set_is_mine(int row, int column, bool value = true) {
+            assert(Inside(row, column, row_count_, column_count_));
+            SetBit(mines_, Offset(row), column, value);
+        }
+
+        // Computes the number of mines around every grid at once with bit-sliced adders.
+        void CountMines() {
+            if (word_count_ == 1) {
+                // Rows of one word, as on the usual boards, are shifted in registers instead of into the scratch planes.
+                for (int row = 1; row <= row_count_; ++row) {
+                    uint64_t above = mines_[row - 1], current = mines_[row], below = mines_[row + 1];
+                    uint64_t bit0 = 0, bit1 = 0, bit2 = 0, bit3 = 0;
+                    AddPlane(above << 1, bit0, bit1, bit2, bit3);
+                    AddPlane(above, bit0, bit1, bit2, bit3);
+                    AddPlane(above >> 1, bit0, bit1, bit2, bit3);
+                    AddPlane(current << 1, bit0, bit1, bit2, bit3);
+                    AddPlane(current >> 1, bit0, bit1, bit2, bit3);
+                    AddPlane(below << 1, bit0, bit1, bit2, bit3);
+                    AddPlane(below, bit0, bit1, bit2, bit3);
+                    AddPlane(below >> 1, bit0, bit1, bit2, bit3);
+                    mine_counts_[0][row] = bit0;
+                    mine_counts_[1][row] = bit1;
+                    mine_counts_[2][row] = bit2;
+                    mine_counts_[3][row] = bit3;
+                }
+                return;
+            }
+            for (int row = 0; row <= row_count_ + 1; ++row) {
+                ShiftLeft(&mines_[Offset(row)], &shifted_left_[Offset(row)]);
+                ShiftRight(&mines_[Offset(row)], &shifted_right_[Offset(row)]);
+            }
+            for (int row = 1; row <= row_count_; ++row) {
+                size_t above = Offset(row - 1), current = Offset(row), below = Offset(row + 1);
+                const uint64_t* const planes[8] = {
+                    &shifted_left_[above], &mines_[above], &shifted_right_[above],
+                    &shifted_left_[current], &shifted_right_[current],
+                    &shifted_left_[below], &mines_[below], &shifted_right_[below],
+                };
+                uint64_t* const sums[4] = {
+                    &mine_counts_[0][current], &mine_counts_[1][current],
+                    &mine_counts_[2][current], &mine_counts_[3][current],
+                };
+                SumPlanes(planes, sums, word_count_);
+            }
+        }
+
+        // Returns the number of mines around a grid, valid after CountMines().
+        int mine_count(int row, int column) const {
+            assert(Inside(row, column, row_count_, column_count_));
+            size_t offset = Offset(row);
+            return GetBit(mine_counts_[0], offset, column)
+                | GetBit(mine_counts_[1], offset, column) << 1
+                | GetBit(mine_counts_[2], offset, column) << 2
+                | GetBit(mine_counts_[3], offset, column) << 3;
+        }
+
+        // Writes the counts from CountMines() into a board of the same size, 8 grids at a time.
+        void WriteMineCounts(Board& board) const {
+            assert(board.row_count() == row_count_ && board.column_count() == column_count_);
+            // Bits 1-4 of a grid, as in Grid.
+            const uint64_t count_mask = 0x1e1e1e1e1e1e1e1e;
+            for (int row = 1; row <= row_count_; ++row) {
+                Grid* grids = &board.cell_ref(board.Index(row, 1));
+                size_t offset = Offset(row);
+                for (int word = 0; word < word_count_; ++word) {
+                    uint64_t bit0 = mine_counts_[0][offset + word];
+                    uint64_t bit1 = mine_counts_[1][offset + word];
+                    uint64_t bit2 = mine_counts_[2][offset + word];
+                    uint64_t bit3 = mine_counts_[3][offset + word];
+                    int bit_count = std::min(64, column_count_ - word * 64);
+                    for (int bit = 0; bit < bit_count; bit += 8) {
+                        uint64_t counts = SpreadLowBits(bit0 >> bit) | SpreadLowBits(bit1 >> bit) << 1
+                            | SpreadLowBits(bit2 >> bit) << 2 | SpreadLowBits(bit3 >> bit) << 3;
+                        int count = std::min(8, bit_count - bit);
+                        Grid* target = grids + word * 64 + bit;
+                        StoreGrids((LoadGrids(target, count) & ~count_mask) | counts << 1, target, count);
+                    }
+                }
+            }
+        }
+
+        // Writes the mask of unknown grids of `row` into `target`.
+        void UnknownRow(int row, uint64_t* target) const {
+            size_t offset = Offset(row);
+            for (int word = 0; word < word_count_; ++word) {
+                target[word] = ~(opened_[offset + word] | flaged_[offset + word]);
+            }
+            target[word_count_ - 1] &= last_word_mask_;
+        }
+
+        // Returns the number of unknown grids.
+        int UnknownCount() const {
+            int result = 0;
+            for (int row = 1; row <= row_count_; ++row) {
+                size_t offset = Offset(row);
+                for (int word = 0; word < word_count_; ++word) {
+                    uint64_t unknown = ~(opened_[offset + word] | flaged_[offset + word]);
+                    if (word + 1 == word_count_) {
+                        unknown &= last_word_mask_;
+                    }
+                    result += PopCount(unknown);
+                }
+            }
+            return result;
+        }
+
+        bool Solved() const {
+            return UnknownCount() == 0;
+        }
+
+        // Computes the mask of opened grids with at least one unknown neighbour, in the same layout as the planes.
+        // `result` keeps its storage between calls, so a reused mask allocates nothing once it has grown.
+        void FrontierMask(vector<uint64_t>& result) {
+            // Dilates the unknown mask into the scratch planes, then keeps the opened grids under it.
+            for (int row = 1; row <= row_count_; ++row) {
+                UnknownRow(row, &unknown_[Offset(row)]);
+            }
+            for (int row = 0; row <= row_count_ + 1; ++row) {
+                ShiftLeft(&unknown_[Offset(row)], &shifted_left_[Offset(row)]);
+                ShiftRight(&unknown_[Offset(row)], &shifted_right_[Offset(row)]);
+            }
+            result.assign(Offset(row_count_ + 2), 0);
+            for (int row = 1; row <= row_count_; ++row) {
+                for (int word = 0; word < word_count_; ++word) {
+                    uint64_t near_unknown = 0;
+                    for (int next_row = row - 1; next_row <= row + 1; ++next_row) {
+                        size_t index = Offset(next_row) + word;
+                        near_unknown |= shifted_left_[index] | shifted_right_[index];
+                        if (next_row != row) {
+                            near_unknown |= unknown_[index];
+                        }
+                    }
+                    result[Offset(row) + word] = opened_[Offset(row) + word] & near_unknown;
+                }
+            }
+        }
+
+        // Calls `function(row, column)` for every set bit of a mask in the layout of the planes.
+        template<class Function>
+        void ForEach(const vector<uint64_t>& mask, Function function) const {
+            for (int row = 1; row <= row_count_; ++row) {
+                size_t offset = Offset(row);
+                for (int word = 0; word < word_count_; ++word) {
+                    uint64_t bits = mask[offset + word];
+                    while (bits) {
+                        int bit = CountTrailingZeros(bits);
+                        bits &= bits - 1;
+                        function(row, word * 64 + bit + 1);
+                    }
+                }
+            }
+        }
+
+        BitBoard(int row_count = 1, int column_count = 1) {
+            Resize(row_count, column_count);
+        }
+
+        ~BitBoard() {}
+    };
+
+    // The bit board of a thread for work that does not keep one: RefreshBitwise(), and the mine planes of attempts.
+    BitBoard& ThreadBitBoard() {
+        static thread_local BitBoard bit_board;
+        return bit_board;
+    }
+
+    // Same as Board::Refresh(), computed on bit planes.
+    void RefreshBitwise(Board& board) {
+        ScopedStage stage(Stage::kRefresh);
+        BitBoard& bit_board = ThreadBitBoard();
+        bit_board.LoadMines(board);
+        bit_board.CountMines();
+        bit_board.WriteMineCounts(board);
+    }
+
+    // Same as Board::Refresh(), with the mines of the board already in the mine plane of `bit_board`.
+    void RefreshBitwise(Board& board, BitBoard& bit_board) {
+        ScopedStage stage(Stage::kRefresh);
+        bit_board.CountMines();
+        bit_board.WriteMineCounts(board);
+    }
+
+    /**
+        @brief Refreshes the mine counts of a board with the backend kUseBitBoard selects.
+        @param mines A bit board holding the mines of `board` already, or null to read them from the board. Unused
+        without kUseBitBoard.
+    */
+    void RefreshMineCounts(Board& board, BitBoard* mines = nullptr) {
+        if (!kUseBitBoard) {
+            board.Refresh();
+        } else if (mines != nullptr) {
+            RefreshBitwise(board, *mines);
+        } else {
+            RefreshBitwise(board);
+        }
+    }
+}
+
+#endif
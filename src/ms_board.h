@@ -1,208 +1,299 @@
-#ifndef MINEALGO_MS_BOARD_H_
-#define MINEALGO_MS_BOARD_H_
-
-#include <algorithm>
-#include <cassert>
-#include <iostream>
-#include <utility>
-#include <vector>
-
-#include "ms_grid.h"
-#include "ms_lib.h"
-
-namespace ms_algo {
-    using std::vector;
-
-    // The game board of minesweeper.
-    class Board {
-    private:
-        // The number of rows of the game board.
-        int row_count_;
-
-        // The number of columns of the game board.
-        int column_count_;
-
-        // The game board.
-        Matrix<Grid> board_;
-
-    public:
-        void Print() const {
-            std::cout << "Current Game Board: " << row_count() << " x " << column_count() << std::endl;
-            for (int row = 1; row <= row_count(); ++row) {
-                for (int column = 1; column <= column_count(); ++column) {
-                    Grid grid = get_grid(row, column);
-                    switch (grid.state())
-                    {
-                    case GridState::kUnknown:
-                        std::cout << '?';
-                        break;
-                    case GridState::kFlaged:
-                        std::cout << 'x';
-                        break;
-                    case GridState::kOpened:
-                        if (grid.mine_count() == 0) {
-                            std::cout << '.';
-                        } else {
-                            std::cout << grid.mine_count();
-                        }
-                    }
-                }
-                std::cout << std::endl;
-            }
-        }
-
-        void PrintAll() const {
-            std::cout << "Actual Game Board: " << row_count() << " x " << column_count() << std::endl;
-            for (int row = 1; row <= row_count(); ++row) {
-                for (int column = 1; column <= column_count(); ++column) {
-                    Grid grid = get_grid(row, column);
-                    if (grid.is_mine()) {
-                        std::cout << '*';
-                    } else if (grid.mine_count() != 0) {
-                        std::cout << grid.mine_count();
-                    } else {
-                        std::cout << '.';
-                    }
-                }
-                std::cout << std::endl;
-            }
-        }
-
-        void Resize(const int row_count, const int column_count) {
-            assert(1 <= row_count && row_count <= 50);
-            assert(1 <= column_count && column_count <= 100);
-            row_count_ = row_count;
-            column_count_ = column_count;
-            board_.resize(row_count + 1);
-            for (auto& column: board_) {
-                column.resize(column_count + 1);
-            }
-        }
-
-        int row_count() const {
-            return row_count_;
-        }
-
-        int column_count() const {
-            return column_count_;
-        }
-
-        Matrix<Grid> board() const {
-            return board_;
-        }
-
-        Matrix<Grid>& board_ref() {
-            return board_;
-        }
-
-        bool Inside(int row, int column) const {
-            return ms_algo::Inside(row, column, row_count(), column_count());
-        }
-
-        Grid get_grid(int row, int column) const {
-            assert(Inside(row, column));
-            return board_[row][column];
-        }
-
-        Grid& get_grid_ref(int row, int column) {
-            assert(Inside(row, column));
-            return board_[row][column];
-        }
-
-        void set_grid(int row, int column, Grid grid) {
-            assert(Inside(row, column));
-            board_[row][column] = grid;
-        }
-
-        int CountMine(int row, int column) {
-            assert(Inside(row, column));
-            int result = 0;
-            for (int index = 0; index < 8; ++index) {
-                int next_row = row + kRowOffset[index];
-                int next_column = column + kColumnOffset[index];
-                if (Inside(next_row, next_column) && get_grid(next_row, next_column).is_mine()) {
-                    ++result;
-                }
-            }
-            get_grid_ref(row, column).set_mine_count(result);
-            return result;
-        }
-
-        void Refresh() {
-            for (int row = 1; row <= row_count(); ++row) {
-                for (int column = 1; column <= column_count(); ++column) {
-                    CountMine(row, column);
-                }
-            }
-        }
-
-        void Open(int row, int column) {
-            assert(Inside(row, column));
-            Grid& current_grid = get_grid_ref(row, column);
-            // assert(current_grid.IsUnknown());
-            assert(!current_grid.is_mine());
-            current_grid.set_state(GridState::kOpened);
-            if (current_grid.mine_count() == 0) {
-                for (int index = 0; index < 8; ++index) {
-                    int next_row = row + kRowOffset[index];
-                    int next_column = column + kColumnOffset[index];
-                    if (Inside(next_row, next_column) && get_grid(next_row, next_column).IsUnknown()) {
-                        Open(next_row, next_column);
-                    }
-                }
-            }
-        }
-
-        // Returns current situation of the board.
-        Matrix<std::pair<GridState, int>> GetSituation() const {
-            Matrix<std::pair<GridState, int>> situation(row_count() + 1, vector<std::pair<GridState, int>>(column_count() + 1));
-            for (int row = 1; row <= row_count(); ++row) {
-                for (int column = 1; column <= column_count(); ++column) {
-                    situation[row][column] = {get_grid(row, column).state(), get_grid(row, column).mine_count()};
-                }
-            }
-            return situation;
-        }
-
-        void SetSituation(Matrix<std::pair<GridState, int>>& situation) {
-            assert((int)situation.size() == row_count() + 1);
-            for (int row = 1; row <= row_count(); ++row) {
-                assert((int)situation[row].size() == column_count() + 1);
-                for (int column = 1; column <= column_count(); ++column) {
-                    if (get_grid(row, column).state() == GridState::kUnknown) {
-                        switch (situation[row][column].first)
-                        {
-                        case GridState::kFlaged:
-                            get_grid_ref(row, column).set_state(GridState::kFlaged);
-                            break;
-                        case GridState::kOpened:
-                            Open(row, column);
-                            break;
-                        default:
-                            break;
-                        }
-                    }
-                }
-            }
-        }
-
-        bool Solved() const {
-            for (int row = 1; row <= row_count(); ++row) {
-                for (int column = 1; column <= column_count(); ++column) {
-                    if (get_grid(row, column).state() == GridState::kUnknown) {
-                        return false;
-                    }
-                }
-            }
-            return true;
-        }
-
-        Board(int row_count = 1, int column_count = 1) {
-            Resize(row_count, column_count);
-        }
-
-        ~Board() {}
-    };
-}
-
+#ifndef MINEALGO_MS_BOARD_H_
+#define MINEALGO_MS_BOARD_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "ms_grid.h"
+#include "ms_instrument.h"
+#include "ms_lib.h"
+
+namespace ms_algo {
+    using std::vector;
+
+    // The game board of minesweeper.
+    class Board {
+    private:
+        // The number of rows of the game board.
+        int row_count_;
+
+        // The number of columns of the game board.
+        int column_count_;
+
+        // The number of grids in one row of the buffer, including the sentinel border.
+        int stride_;
+
+        // Index offsets of the 8 neighbours in the buffer.
+        int neighbour_offsets_[8];
+
+        // The game board, stored row by row with a one-grid sentinel border.
+        // Sentinel grids are opened, not mine, and never counted.
+        AlignedVector<Grid> cells_;
+
+        // The seed the random mines were placed with, or 0 if they were not.
+        uint64_t seed_ = 0;
+
+    public:
+        void Print() const {
+            std::cout << "Current Game Board: " << row_count() << " x " << column_count() << std::endl;
+            for (int row = 1; row <= row_count(); ++row) {
+                for (int column = 1; column <= column_count(); ++column) {
+                    Grid grid = get_grid(row, column);
+                    switch (grid.state())
+                    {
+                    case GridState::kUnknown:
+                        std::cout << '?';
+                        break;
+                    case GridState::kFlaged:
+                        std::cout << 'x';
+                        break;
+                    case GridState::kOpened:
+                        if (grid.mine_count() == 0) {
+                            std::cout << '.';
+                        } else {
+                            std::cout << grid.mine_count();
+                        }
+                    }
+                }
+                std::cout << std::endl;
+            }
+        }
+
+        void PrintAll() const {
+            std::cout << "Actual Game Board: " << row_count() << " x " << column_count() << std::endl;
+            for (int row = 1; row <= row_count(); ++row) {
+                for (int column = 1; column <= column_count(); ++column) {
+                    Grid grid = get_grid(row, column);
+                    if (grid.is_mine()) {
+                        std::cout << '*';
+                    } else if (grid.mine_count() != 0) {
+                        std::cout << grid.mine_count();
+                    } else {
+                        std::cout << '.';
+                    }
+                }
+                std::cout << std::endl;
+            }
+        }
+
+        void Resize(const int row_count, const int column_count) {
+            assert(1 <= row_count && row_count <= kMaxRowCount);
+            assert(1 <= column_count && column_count <= kMaxColumnCount);
+            row_count_ = row_count;
+            column_count_ = column_count;
+            stride_ = column_count + 2;
+            for (int index = 0; index < 8; ++index) {
+                neighbour_offsets_[index] = kRowOffset[index] * stride_ + kColumnOffset[index];
+            }
+            cells_.assign((size_t)(row_count + 2) * stride_, Grid());
+            for (int column = 0; column <= column_count + 1; ++column) {
+                cells_[Index(0, column)].set_state(GridState::kOpened);
+                cells_[Index(row_count + 1, column)].set_state(GridState::kOpened);
+            }
+            for (int row = 1; row <= row_count; ++row) {
+                cells_[Index(row, 0)].set_state(GridState::kOpened);
+                cells_[Index(row, column_count + 1)].set_state(GridState::kOpened);
+            }
+        }
+
+        uint64_t seed() const {
+            return seed_;
+        }
+
+        void set_seed(uint64_t seed) {
+            seed_ = seed;
+        }
+
+        int row_count() const {
+            return row_count_;
+        }
+
+        int column_count() const {
+            return column_count_;
+        }
+
+        int stride() const {
+            return stride_;
+        }
+
+        // Returns the buffer index of a grid.
+        int Index(int row, int column) const {
+            return row * stride_ + column;
+        }
+
+        int Row(int index) const {
+            return index / stride_;
+        }
+
+        int Column(int index) const {
+            return index % stride_;
+        }
+
+        // Returns the buffer index offset of the neighbour in direction `index`.
+        int neighbour_offset(int index) const {
+            return neighbour_offsets_[index];
+        }
+
+        const AlignedVector<Grid>& cells() const {
+            return cells_;
+        }
+
+        Grid cell(int index) const {
+            return cells_[index];
+        }
+
+        Grid& cell_ref(int index) {
+            return cells_[index];
+        }
+
+        bool Inside(int row, int column) const {
+            return ms_algo::Inside(row, column, row_count(), column_count());
+        }
+
+        Grid get_grid(int row, int column) const {
+            assert(Inside(row, column));
+            return cells_[Index(row, column)];
+        }
+
+        Grid& get_grid_ref(int row, int column) {
+            assert(Inside(row, column));
+            return cells_[Index(row, column)];
+        }
+
+        void set_grid(int row, int column, Grid grid) {
+            assert(Inside(row, column));
+            cells_[Index(row, column)] = grid;
+        }
+
+        int CountMine(int row, int column) {
+            assert(Inside(row, column));
+            return CountMine(Index(row, column));
+        }
+
+        // Counts the mines around the grid at buffer index `index`, which must be inside the board.
+        int CountMine(int index) {
+            int result = 0;
+            for (int offset: neighbour_offsets_) {
+                result += cells_[index + offset].is_mine();
+            }
+            cells_[index].set_mine_count(result);
+            return result;
+        }
+
+        // Adds `delta` to the mine counts of the grids around (row, column).
+        void AddMineCount(int row, int column, int delta) {
+            for (int next_row = row - 1; next_row <= row + 1; ++next_row) {
+                for (int next_column = column - 1; next_column <= column + 1; ++next_column) {
+                    if ((next_row != row || next_column != column) && Inside(next_row, next_column)) {
+                        Grid& grid = get_grid_ref(next_row, next_column);
+                        grid.set_mine_count(grid.mine_count() + delta);
+                    }
+                }
+            }
+        }
+
+        // Moves a mine to a grid which is not mine, updating the mine counts around both instead of refreshing.
+        void MoveMine(int from_row, int from_column, int to_row, int to_column) {
+            assert(get_grid(from_row, from_column).is_mine() && !get_grid(to_row, to_column).is_mine());
+            get_grid_ref(from_row, from_column).set_is_mine(false);
+            AddMineCount(from_row, from_column, -1);
+            get_grid_ref(to_row, to_column).set_is_mine();
+            AddMineCount(to_row, to_column, 1);
+        }
+
+        void Refresh() {
+            ScopedStage stage(Stage::kRefresh);
+            for (int row = 1; row <= row_count(); ++row) {
+                int row_end = Index(row, column_count());
+                for (int index = Index(row, 1); index <= row_end; ++index) {
+                    CountMine(index);
+                }
+            }
+        }
+
+        void Open(int row, int column) {
+            assert(Inside(row, column));
+            Grid& current_grid = get_grid_ref(row, column);
+            // assert(current_grid.IsUnknown());
+            assert(!current_grid.is_mine());
+            current_grid.set_state(GridState::kOpened);
+            if (current_grid.mine_count() != 0) {
+                return;
+            }
+
+            // Sentinel grids are opened, so the flood fill stops at the border by itself.
+            vector<int> pending(1, Index(row, column));
+            while (!pending.empty()) {
+                int index = pending.back();
+                pending.pop_back();
+                for (int offset: neighbour_offsets_) {
+                    Grid& next_grid = cells_[index + offset];
+                    if (next_grid.IsUnknown()) {
+                        assert(!next_grid.is_mine());
+                        next_grid.set_state(GridState::kOpened);
+                        if (next_grid.mine_count() == 0) {
+                            pending.push_back(index + offset);
+                        }
+                    }
+                }
+            }
+        }
+
+        // Returns current situation of the board.
+        Matrix<std::pair<GridState, int>> GetSituation() const {
+            Matrix<std::pair<GridState, int>> situation(row_count() + 1, vector<std::pair<GridState, int>>(column_count() + 1));
+            for (int row = 1; row <= row_count(); ++row) {
+                for (int column = 1; column <= column_count(); ++column) {
+                    situation[row][column] = {get_grid(row, column).state(), get_grid(row, column).mine_count()};
+                }
+            }
+            return situation;
+        }
+
+        void SetSituation(Matrix<std::pair<GridState, int>>& situation) {
+            assert((int)situation.size() == row_count() + 1);
+            for (int row = 1; row <= row_count(); ++row) {
+                assert((int)situation[row].size() == column_count() + 1);
+                for (int column = 1; column <= column_count(); ++column) {
+                    if (get_grid(row, column).state() == GridState::kUnknown) {
+                        switch (situation[row][column].first)
+                        {
+                        case GridState::kFlaged:
+                            get_grid_ref(row, column).set_state(GridState::kFlaged);
+                            break;
+                        case GridState::kOpened:
+                            Open(row, column);
+                            break;
+                        default:
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        bool Solved() const {
+            for (int row = 1; row <= row_count(); ++row) {
+                int row_end = Index(row, column_count());
+                for (int index = Index(row, 1); index <= row_end; ++index) {
+                    if (cells_[index].IsUnknown()) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        Board(int row_count = 1, int column_count = 1) {
+            Resize(row_count, column_count);
+        }
+
+        ~Board() {}
+    };
+}
+
 #endif
\ No newline at end of file
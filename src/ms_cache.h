@@ -0,0 +1,237 @@
+#ifndef MINEALGO_MS_CACHE_H_
+#define MINEALGO_MS_CACHE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ms_region.h"
+
+namespace ms_algo {
+    using std::vector;
+
+    // A region's constraint system in a form shared by every copy of it, whatever its place, rotation,
+    // reflection and variable order.
+    struct CanonicalRegion {
+        // The canonical encoding, compared exactly by RegionCache.
+        std::string key;
+
+        // The region variable of each canonical variable.
+        vector<int> order;
+    };
+
+    /**
+        @brief Computes the canonical form of a region.
+
+        For each of the 8 rotations and reflections, the unknown grids are moved to start at (0, 0) and numbered
+        in row-major order, which undoes the order Divide() gives them. The positions, then the constraints as
+        sorted (variables, value) lists, are encoded, and the smallest of the 8 encodings is the key. The key holds
+        the whole system, so two regions with the same key have the same solutions.
+        Writes into `result`, and works in per-thread buffers, so that nothing is allocated once they are large enough.
+    */
+    void CanonicalizeRegion(const Region& region, CanonicalRegion& result) {
+        const Positions& positions = region.first;
+        const SparseMatrix& constraints = region.second;
+        int variable_count = positions.size();
+
+        auto append = [](std::string& key, int value) {
+            key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        };
+
+        static thread_local vector<std::pair<int, int>> moved;
+        static thread_local vector<int> order, rank;
+        static thread_local std::string key;
+        // Only the first constraints.size() rows are used. The others are kept for their memory.
+        static thread_local vector<vector<int>> rows;
+        moved.resize(variable_count);
+        order.resize(variable_count);
+        rank.resize(variable_count);
+        if (rows.size() < constraints.size()) {
+            rows.resize(constraints.size());
+        }
+        auto rows_end = rows.begin() + constraints.size();
+        for (int symmetry = 0; symmetry < 8; ++symmetry) {
+            int min_row = std::numeric_limits<int>::max(), min_column = std::numeric_limits<int>::max();
+            for (int variable = 0; variable < variable_count; ++variable) {
+                auto [row, column] = positions[variable];
+                if (symmetry & 1) {
+                    std::swap(row, column);
+                }
+                moved[variable] = {symmetry & 2 ? -row : row, symmetry & 4 ? -column : column};
+                min_row = std::min(min_row, moved[variable].first);
+                min_column = std::min(min_column, moved[variable].second);
+            }
+            for (auto& [row, column]: moved) {
+                row -= min_row;
+                column -= min_column;
+            }
+            for (int variable = 0; variable < variable_count; ++variable) {
+                order[variable] = variable;
+            }
+            std::sort(order.begin(), order.end(), [](int lhs, int rhs) {
+                return moved[lhs] < moved[rhs];
+            });
+            for (int index = 0; index < variable_count; ++index) {
+                rank[order[index]] = index;
+            }
+            for (size_t index = 0; index < constraints.size(); ++index) {
+                rows[index].clear();
+                for (auto [variable, coefficient]: constraints[index].entries) {
+                    rows[index].push_back(rank[variable]);
+                }
+                std::sort(rows[index].begin(), rows[index].end());
+                rows[index].push_back(constraints[index].value);
+            }
+            std::sort(rows.begin(), rows_end);
+
+            key.clear();
+            append(key, variable_count);
+            append(key, (int)constraints.size());
+            for (int index = 0; index < variable_count; ++index) {
+                append(key, moved[order[index]].first);
+                append(key, moved[order[index]].second);
+            }
+            for (auto row = rows.begin(); row != rows_end; ++row) {
+                append(key, (int)row->size());
+                for (int value: *row) {
+                    append(key, value);
+                }
+            }
+            if (symmetry == 0 || key < result.key) {
+                result.key = key;
+                result.order = order;
+            }
+        }
+    }
+
+    // Returns the canonical form of a region. See CanonicalizeRegion(region, result).
+    CanonicalRegion CanonicalizeRegion(const Region& region) {
+        CanonicalRegion result;
+        CanonicalizeRegion(region, result);
+        return result;
+    }
+
+    /**
+        A thread-safe, size-bounded cache of region results, keyed by CanonicalRegion::key.
+        Entries hold the forced grids as (canonical variable, whether it is mine). The cache is split into
+        shards, each with its own mutex and least-recently-used list, so that generator threads rarely wait
+        for each other.
+    */
+    class RegionCache {
+    private:
+        static const int kShardCount = 16;
+
+        using Entry = std::pair<std::string, vector<std::pair<int, int>>>;
+
+        struct Shard {
+            std::mutex mutex;
+
+            // Most recently used first.
+            std::list<Entry> entries;
+            std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        };
+
+        Shard shards_[kShardCount];
+        size_t shard_capacity_;
+        int max_variable_count_;
+
+        std::atomic<int64_t> hit_count_{0};
+        std::atomic<int64_t> miss_count_{0};
+        std::atomic<int64_t> eviction_count_{0};
+
+        Shard& ShardOf(const std::string& key) {
+            return shards_[std::hash<std::string>()(key) % kShardCount];
+        }
+
+    public:
+        // Holds up to about `capacity` regions with at most `max_variable_count` unknown grids.
+        explicit RegionCache(size_t capacity = 1 << 16, int max_variable_count = 64)
+            : shard_capacity_(std::max<size_t>(1, capacity / kShardCount)), max_variable_count_(max_variable_count) {}
+
+        RegionCache(const RegionCache&) = delete;
+        RegionCache& operator=(const RegionCache&) = delete;
+
+        // Larger regions are not cached: they rarely repeat, and their keys cost more than they save.
+        int max_variable_count() const {
+            return max_variable_count_;
+        }
+
+        // Finds the result of a region. Returns whether it was found.
+        bool Lookup(const std::string& key, vector<std::pair<int, int>>& solved) {
+            Shard& shard = ShardOf(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.index.find(key);
+            if (it == shard.index.end()) {
+                ++miss_count_;
+                return false;
+            }
+            ++hit_count_;
+            shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+            solved = it->second->second;
+            return true;
+        }
+
+        // Stores the result of a region, evicting the least recently used one of its shard if full.
+        void Insert(const std::string& key, vector<std::pair<int, int>> solved) {
+            Shard& shard = ShardOf(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.index.find(key);
+            if (it != shard.index.end()) {
+                shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+                return;
+            }
+            shard.entries.emplace_front(key, std::move(solved));
+            shard.index.emplace(key, shard.entries.begin());
+            if (shard.entries.size() > shard_capacity_) {
+                shard.index.erase(shard.entries.back().first);
+                shard.entries.pop_back();
+                ++eviction_count_;
+            }
+        }
+
+        void Clear() {
+            for (Shard& shard: shards_) {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                shard.entries.clear();
+                shard.index.clear();
+            }
+        }
+
+        size_t size() {
+            size_t result = 0;
+            for (Shard& shard: shards_) {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                result += shard.entries.size();
+            }
+            return result;
+        }
+
+        int64_t hit_count() const {
+            return hit_count_;
+        }
+
+        int64_t miss_count() const {
+            return miss_count_;
+        }
+
+        int64_t eviction_count() const {
+            return eviction_count_;
+        }
+    };
+
+    // The cache shared by the generator threads.
+    RegionCache& SharedRegionCache() {
+        static RegionCache cache;
+        return cache;
+    }
+}
+
+#endif
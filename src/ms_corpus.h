@@ -0,0 +1,514 @@
+#ifndef MINEALGO_MS_CORPUS_H_
+#define MINEALGO_MS_CORPUS_H_
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "ms_batch.h"
+#include "ms_bitboard.h"
+#include "ms_board.h"
+#include "ms_generate.h"
+#include "ms_grid.h"
+
+namespace ms_algo {
+    using std::vector;
+
+    /**
+        The fixed part of an encoded board, followed by the mines as one bit per grid in row-major order, then, if
+        `flags` has kRecordHasState, the states as two bits per grid (GridState). Bits are taken from the lowest one of
+        each byte. Mine counts are not stored: they follow from the mines. Fields are little-endian, like the hosts the
+        encoding is meant for.
+    */
+    struct BoardRecordHeader {
+        uint16_t row_count;
+        uint16_t column_count;
+        uint32_t mine_count;
+
+        // The starting position and type the board was generated with. 0 for a start drawn for the board.
+        uint16_t start_row;
+        uint16_t start_column;
+        uint8_t type;
+        uint8_t flags;
+        uint16_t reserved;
+
+        // Board::seed().
+        uint64_t seed;
+    };
+    static_assert(sizeof(BoardRecordHeader) == 24, "BoardRecordHeader is written as is");
+
+    const uint8_t kRecordHasState = 1;
+
+    // The size of an encoded board.
+    size_t EncodedBoardSize(int row_count, int column_count, bool with_state) {
+        size_t grid_count = (size_t)row_count * column_count;
+        return sizeof(BoardRecordHeader) + (grid_count + 7) / 8 + (with_state ? (grid_count + 3) / 4 : 0);
+    }
+
+    /**
+        @brief Appends the encoding of a board to `out`.
+        @param spec The parameters the board was generated with. Its size must be the size of the board.
+        @param with_state Whether to keep the states of the grids, or only the mines.
+    */
+    void EncodeBoard(const Board& board, const GenerateSpec& spec, bool with_state, vector<uint8_t>& out) {
+        int row_count = board.row_count(), column_count = board.column_count();
+        assert(spec.row_count == row_count && spec.column_count == column_count);
+        size_t grid_count = (size_t)row_count * column_count;
+        size_t beginning = out.size();
+        out.resize(beginning + EncodedBoardSize(row_count, column_count, with_state), 0);
+
+        uint8_t* mines = out.data() + beginning + sizeof(BoardRecordHeader);
+        uint8_t* states = mines + (grid_count + 7) / 8;
+        BoardRecordHeader header{};
+        size_t bit = 0;
+        for (int row = 1; row <= row_count; ++row) {
+            for (int column = 1; column <= column_count; ++column, ++bit) {
+                Grid grid = board.get_grid(row, column);
+                if (grid.is_mine()) {
+                    mines[bit >> 3] |= 1 << (bit & 7);
+                    ++header.mine_count;
+                }
+                if (with_state) {
+                    states[bit >> 2] |= grid.state() << ((bit & 3) * 2);
+                }
+            }
+        }
+        header.row_count = row_count;
+        header.column_count = column_count;
+        header.start_row = spec.start_row;
+        header.start_column = spec.start_column;
+        header.type = spec.type;
+        header.flags = with_state ? kRecordHasState : 0;
+        header.seed = board.seed();
+        std::memcpy(out.data() + beginning, &header, sizeof(header));
+    }
+
+    /**
+        An encoded board read in place, without copying it. Reads grids straight from the encoding, or decodes the
+        whole board into a Board. The encoding must outlive the view.
+    */
+    class BoardView {
+    private:
+        const uint8_t* data_ = nullptr;
+        BoardRecordHeader header_{};
+        bool valid_ = false;
+
+        size_t BitIndex(int row, int column) const {
+            assert(1 <= row && row <= header_.row_count && 1 <= column && column <= header_.column_count);
+            return (size_t)(row - 1) * header_.column_count + (column - 1);
+        }
+
+        const uint8_t* states() const {
+            return data_ + sizeof(BoardRecordHeader) + ((size_t)header_.row_count * header_.column_count + 7) / 8;
+        }
+
+    public:
+        BoardView() {}
+
+        // Checks the fixed part and the size of an encoding of `size` bytes. See valid().
+        BoardView(const uint8_t* data, size_t size) : data_(data) {
+            if (data == nullptr || size < sizeof(BoardRecordHeader)) {
+                return;
+            }
+            std::memcpy(&header_, data, sizeof(header_));
+            valid_ = 1 <= header_.row_count && header_.row_count <= kMaxRowCount
+                && 1 <= header_.column_count && header_.column_count <= kMaxColumnCount
+                && header_.start_row <= header_.row_count && header_.start_column <= header_.column_count
+                && header_.type <= GenerateType::kConstructive && (header_.flags & ~kRecordHasState) == 0
+                && size == EncodedBoardSize(header_.row_count, header_.column_count, has_state());
+        }
+
+        // Whether the encoding is well formed. Nothing else may be called otherwise.
+        bool valid() const {
+            return valid_;
+        }
+
+        int row_count() const {
+            return header_.row_count;
+        }
+
+        int column_count() const {
+            return header_.column_count;
+        }
+
+        int mine_count() const {
+            return header_.mine_count;
+        }
+
+        uint64_t seed() const {
+            return header_.seed;
+        }
+
+        bool has_state() const {
+            return header_.flags & kRecordHasState;
+        }
+
+        // The parameters the board was generated with. The time limit is not stored and left at its default.
+        GenerateSpec spec() const {
+            GenerateSpec result;
+            result.row_count = header_.row_count;
+            result.column_count = header_.column_count;
+            result.start_row = header_.start_row;
+            result.start_column = header_.start_column;
+            result.random_mine_count = header_.mine_count;
+            result.type = GenerateType(header_.type);
+            return result;
+        }
+
+        bool is_mine(int row, int column) const {
+            size_t bit = BitIndex(row, column);
+            return data_[sizeof(BoardRecordHeader) + (bit >> 3)] >> (bit & 7) & 1;
+        }
+
+        // The state of a grid, kUnknown for all if the state was not kept.
+        GridState state(int row, int column) const {
+            if (!has_state()) {
+                return GridState::kUnknown;
+            }
+            size_t bit = BitIndex(row, column);
+            return GridState(states()[bit >> 2] >> ((bit & 3) * 2) & 3);
+        }
+
+        // Rebuilds the board, with its mine counts, states and seed.
+        void Decode(Board& board) const {
+            assert(valid());
+            int row_count = header_.row_count, column_count = header_.column_count;
+            board.Resize(row_count, column_count);
+            for (int row = 1; row <= row_count; ++row) {
+                for (int column = 1; column <= column_count; ++column) {
+                    if (is_mine(row, column)) {
+                        board.get_grid_ref(row, column).set_is_mine();
+                    }
+                }
+            }
+            RefreshMineCounts(board);
+            if (has_state()) {
+                for (int row = 1; row <= row_count; ++row) {
+                    for (int column = 1; column <= column_count; ++column) {
+                        board.get_grid_ref(row, column).set_state(state(row, column));
+                    }
+                }
+            }
+            board.set_seed(header_.seed);
+        }
+    };
+
+    // Decodes a board encoded by EncodeBoard(), and its parameters if `spec` is not null. Returns false if the
+    // encoding is not well formed, leaving both untouched.
+    bool DecodeBoard(const uint8_t* data, size_t size, Board& board, GenerateSpec* spec = nullptr) {
+        BoardView view(data, size);
+        if (!view.valid()) {
+            return false;
+        }
+        view.Decode(board);
+        if (spec != nullptr) {
+            *spec = view.spec();
+        }
+        return true;
+    }
+
+    /*
+        A corpus is an append-only pair of files. The data file `path` holds the encoded boards back to back, and the
+        index file `path.idx` an entry of a fixed size per board, so that board `i` is found at a known place without
+        reading the others. Both start with a 16-byte header: an 8-byte magic and a version.
+        A board is written to the data file before its entry, so a reader that sees an entry sees its board.
+    */
+    struct CorpusFileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(CorpusFileHeader) == 16, "CorpusFileHeader is written as is");
+
+    struct CorpusIndexEntry {
+        uint64_t offset;
+        uint32_t size;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(CorpusIndexEntry) == 16, "CorpusIndexEntry is written as is");
+
+    const char kCorpusDataMagic[8] = {'M', 'S', 'B', 'O', 'A', 'R', 'D', 'S'};
+    const char kCorpusIndexMagic[8] = {'M', 'S', 'B', 'I', 'N', 'D', 'E', 'X'};
+    const uint32_t kCorpusVersion = 1;
+
+    std::string CorpusIndexPath(const std::string& path) {
+        return path + ".idx";
+    }
+
+    bool CheckCorpusHeader(const uint8_t* data, size_t size, const char (&magic)[8]) {
+        if (size < sizeof(CorpusFileHeader)) {
+            return false;
+        }
+        CorpusFileHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        return std::memcmp(header.magic, magic, sizeof(magic)) == 0 && header.version == kCorpusVersion;
+    }
+
+    /**
+        Appends boards to a corpus, creating it if it does not exist. One writer at a time; readers may read meanwhile.
+        An index entry cut short by a crash is dropped on opening, and the board it belonged to is left unreferenced.
+    */
+    class CorpusWriter {
+    private:
+        std::ofstream data_;
+        std::ofstream index_;
+        uint64_t data_size_ = 0;
+        size_t size_ = 0;
+        vector<uint8_t> buffer_;
+
+        static bool OpenFile(const std::string& path, const char (&magic)[8], std::ofstream& stream, uint64_t& file_size) {
+            std::error_code error;
+            file_size = std::filesystem::exists(path, error) ? std::filesystem::file_size(path, error) : 0;
+            if (error) {
+                return false;
+            }
+            if (file_size != 0) {
+                uint8_t bytes[sizeof(CorpusFileHeader)] = {};
+                std::ifstream existing(path, std::ios::binary);
+                existing.read(reinterpret_cast<char*>(bytes), sizeof(bytes));
+                if (!existing || !CheckCorpusHeader(bytes, sizeof(bytes), magic)) {
+                    return false;
+                }
+            }
+            stream.open(path, std::ios::binary | std::ios::app);
+            if (!stream) {
+                return false;
+            }
+            if (file_size == 0) {
+                CorpusFileHeader header{};
+                std::memcpy(header.magic, magic, sizeof(magic));
+                header.version = kCorpusVersion;
+                stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                file_size = sizeof(header);
+            }
+            return (bool)stream.flush();
+        }
+
+    public:
+        CorpusWriter() {}
+
+        explicit CorpusWriter(const std::string& path) {
+            Open(path);
+        }
+
+        // Opens a corpus for appending. Returns false if a file cannot be opened or is not a corpus of this version.
+        bool Open(const std::string& path) {
+            Close();
+            std::string index_path = CorpusIndexPath(path);
+            std::error_code error;
+            if (std::filesystem::exists(index_path, error)) {
+                uint64_t index_size = std::filesystem::file_size(index_path, error);
+                uint64_t whole_size = index_size < sizeof(CorpusFileHeader) ? index_size
+                    : index_size - (index_size - sizeof(CorpusFileHeader)) % sizeof(CorpusIndexEntry);
+                if (!error && whole_size != index_size) {
+                    std::filesystem::resize_file(index_path, whole_size, error);
+                }
+                if (error) {
+                    return false;
+                }
+            }
+            uint64_t index_size;
+            if (!OpenFile(path, kCorpusDataMagic, data_, data_size_) || !OpenFile(index_path, kCorpusIndexMagic, index_, index_size)) {
+                Close();
+                return false;
+            }
+            size_ = (index_size - sizeof(CorpusFileHeader)) / sizeof(CorpusIndexEntry);
+            return true;
+        }
+
+        void Close() {
+            data_.close();
+            index_.close();
+            data_size_ = 0;
+            size_ = 0;
+        }
+
+        bool is_open() const {
+            return data_.is_open() && index_.is_open();
+        }
+
+        // The number of boards in the corpus.
+        size_t size() const {
+            return size_;
+        }
+
+        /**
+            Appends a board, see EncodeBoard(). Returns false if it could not be written, or the writer is not open.
+            A failed write may leave part of it in the files, so the writer closes itself rather than write index
+            entries at offsets it no longer knows. Opening the corpus again picks up from the sizes of the files.
+        */
+        bool Append(const Board& board, const GenerateSpec& spec, bool with_state = true) {
+            if (!is_open()) {
+                return false;
+            }
+            buffer_.clear();
+            EncodeBoard(board, spec, with_state, buffer_);
+            CorpusIndexEntry entry{data_size_, (uint32_t)buffer_.size(), 0};
+            if (!data_.write(reinterpret_cast<const char*>(buffer_.data()), buffer_.size()).flush()) {
+                Close();
+                return false;
+            }
+            data_size_ += buffer_.size();
+            if (!index_.write(reinterpret_cast<const char*>(&entry), sizeof(entry)).flush()) {
+                Close();
+                return false;
+            }
+            ++size_;
+            return true;
+        }
+    };
+
+    /**
+        A read-only file mapped into memory, shared between the processes mapping it. Where mmap() is not available,
+        the file is read into memory instead.
+    */
+    class MappedFile {
+    private:
+        const uint8_t* data_ = nullptr;
+        size_t size_ = 0;
+        vector<uint8_t> buffer_;
+
+    public:
+        MappedFile() {}
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile() {
+            Close();
+        }
+
+        bool Open(const std::string& path) {
+            Close();
+#if defined(__unix__) || defined(__APPLE__)
+            int descriptor = ::open(path.c_str(), O_RDONLY);
+            if (descriptor == -1) {
+                return false;
+            }
+            struct stat status;
+            bool result = ::fstat(descriptor, &status) == 0;
+            if (result && status.st_size != 0) {
+                void* address = ::mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+                if (address == MAP_FAILED) {
+                    result = false;
+                } else {
+                    data_ = static_cast<const uint8_t*>(address);
+                    size_ = status.st_size;
+                }
+            }
+            ::close(descriptor);
+            return result;
+#else
+            std::ifstream stream(path, std::ios::binary | std::ios::ate);
+            if (!stream) {
+                return false;
+            }
+            buffer_.resize((size_t)stream.tellg());
+            stream.seekg(0);
+            if (!stream.read(reinterpret_cast<char*>(buffer_.data()), buffer_.size())) {
+                buffer_.clear();
+                return false;
+            }
+            data_ = buffer_.data();
+            size_ = buffer_.size();
+            return true;
+#endif
+        }
+
+        void Close() {
+#if defined(__unix__) || defined(__APPLE__)
+            if (data_ != nullptr) {
+                ::munmap(const_cast<uint8_t*>(data_), size_);
+            }
+#endif
+            buffer_.clear();
+            data_ = nullptr;
+            size_ = 0;
+        }
+
+        const uint8_t* data() const {
+            return data_;
+        }
+
+        size_t size() const {
+            return size_;
+        }
+    };
+
+    /**
+        Reads a corpus in place through mmap(), so that opening it costs the same whatever its size and boards are
+        read without copies. Any number of processes and threads may read one corpus at once. Boards appended after
+        opening are seen after Refresh(), which must not run while other threads read.
+    */
+    class CorpusReader {
+    private:
+        std::string path_;
+        MappedFile data_;
+        MappedFile index_;
+        size_t size_ = 0;
+
+    public:
+        CorpusReader() {}
+
+        explicit CorpusReader(const std::string& path) {
+            Open(path);
+        }
+
+        // Maps a corpus. Returns false if a file cannot be mapped or is not a corpus of this version.
+        bool Open(const std::string& path) {
+            Close();
+            // The index is mapped first: the data file is at least as long as its entries need by then.
+            if (!index_.Open(CorpusIndexPath(path)) || !data_.Open(path)
+                || !CheckCorpusHeader(index_.data(), index_.size(), kCorpusIndexMagic)
+                || !CheckCorpusHeader(data_.data(), data_.size(), kCorpusDataMagic)) {
+                Close();
+                return false;
+            }
+            path_ = path;
+            size_ = (index_.size() - sizeof(CorpusFileHeader)) / sizeof(CorpusIndexEntry);
+            return true;
+        }
+
+        // Maps the corpus again, to see the boards appended since it was opened.
+        bool Refresh() {
+            std::string path = path_;
+            return Open(path);
+        }
+
+        void Close() {
+            index_.Close();
+            data_.Close();
+            size_ = 0;
+        }
+
+        // The number of boards in the corpus.
+        size_t size() const {
+            return size_;
+        }
+
+        // Returns board `index`, or an invalid view if its entry or encoding is damaged.
+        BoardView operator[](size_t index) const {
+            assert(index < size_);
+            CorpusIndexEntry entry;
+            std::memcpy(&entry, index_.data() + sizeof(CorpusFileHeader) + index * sizeof(CorpusIndexEntry), sizeof(entry));
+            if (entry.offset < sizeof(CorpusFileHeader) || entry.offset > data_.size() || entry.size > data_.size() - entry.offset) {
+                return BoardView();
+            }
+            return BoardView(data_.data() + entry.offset, entry.size);
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,277 @@
+#ifndef MINEALGO_MS_COUNT_H_
+#define MINEALGO_MS_COUNT_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ms_bigint.h"
+#include "ms_lib.h"
+#include "ms_region.h"
+#include "ms_timer.h"
+
+namespace ms_algo {
+    using std::vector;
+
+    // A solution count grouped by the number of mines: `ways[k]` solutions use `k` mines.
+    using MinePolynomial = vector<BigUnsigned>;
+
+    // Adds `source`, with `mines` more mines, into `target`.
+    void AddShifted(BigUnsigned& target, const BigUnsigned& source, int) {
+        target += source;
+    }
+
+    void AddShifted(MinePolynomial& target, const MinePolynomial& source, int mines) {
+        if (target.size() < source.size() + mines) {
+            target.resize(source.size() + mines);
+        }
+        for (size_t index = 0; index < source.size(); ++index) {
+            target[index + mines] += source[index];
+        }
+    }
+
+    // Adds `lhs * rhs`, with `mines` more mines, into `target`.
+    void AddProduct(BigUnsigned& target, const BigUnsigned& lhs, const BigUnsigned& rhs, int) {
+        target += lhs * rhs;
+    }
+
+    void AddProduct(MinePolynomial& target, const MinePolynomial& lhs, const MinePolynomial& rhs, int mines) {
+        if (lhs.empty() || rhs.empty()) {
+            return;
+        }
+        if (target.size() < lhs.size() + rhs.size() - 1 + mines) {
+            target.resize(lhs.size() + rhs.size() - 1 + mines);
+        }
+        for (size_t i = 0; i < lhs.size(); ++i) {
+            if (lhs[i].IsZero()) {
+                continue;
+            }
+            for (size_t j = 0; j < rhs.size(); ++j) {
+                if (!rhs[j].IsZero()) {
+                    target[i + j + mines] += lhs[i] * rhs[j];
+                }
+            }
+        }
+    }
+
+    void SetOne(BigUnsigned& value) {
+        value = BigUnsigned(1);
+    }
+
+    void SetOne(MinePolynomial& value) {
+        value.assign(1, BigUnsigned(1));
+    }
+
+    bool IsZero(const BigUnsigned& value) {
+        return value.IsZero();
+    }
+
+    bool IsZero(const MinePolynomial& value) {
+        return std::all_of(value.begin(), value.end(), [](const BigUnsigned& number) {
+            return number.IsZero();
+        });
+    }
+
+    // CountMineByFrontier() gives up when a layer holds more states than this.
+    const size_t kMaxFrontierStates = 1 << 20;
+
+    // Describes how one constraint moves from the boundary before variable `t` to the boundary after it.
+    struct FrontierTransition {
+        // The position of the constraint in the state before, or -1 if it starts at `t`.
+        int source;
+
+        // The right-hand side of the constraint, used when it starts at `t`.
+        int value;
+
+        // Whether the constraint contains `t`.
+        bool contains;
+
+        // The number of its variables after `t`.
+        int cells_after;
+    };
+
+    /**
+        @brief Counts the solutions of a region's constraints exactly, with a DP along the variable order.
+        @param constraints The region's constraints before elimination, with coefficients of 1.
+        @tparam Value BigUnsigned for plain counts, or MinePolynomial for counts grouped by the number of mines.
+        @return The number of solutions and, for each variable, the number of solutions where it is mine.
+            Empty on timeout, or if the frontier is too wide (see kMaxFrontierStates).
+
+        Variables are assigned in index order, which follows the frontier. Between two variables, the only thing
+        that matters about the assigned part is how many mines each open constraint (one with variables on both
+        sides) still needs, so solutions are merged by that state. The number of states depends on the frontier width
+        rather than the region size. Per-variable counts combine a forward pass (ways to reach a state) and a backward
+        pass (ways to complete it). The forward pass keeps one layer in every sqrt(n) of the n variables, and the
+        backward pass recomputes the layers between two of them when it gets there, so at most about 2 sqrt(n) layers
+        are held at once, for about twice the forward work.
+    */
+    template<class Value>
+    std::pair<Value, vector<Value>> CountByFrontier(const SparseMatrix& constraints, int variable_count, Timer& timer) {
+        // The transitions of the open constraints after each variable, and of the constraints closing at it.
+        vector<vector<FrontierTransition>> opened(variable_count), closed(variable_count);
+        vector<int> first(constraints.size()), last(constraints.size());
+        for (size_t index = 0; index < constraints.size(); ++index) {
+            assert(!constraints[index].entries.empty());
+            first[index] = constraints[index].entries.front().first;
+            last[index] = constraints[index].entries.back().first;
+        }
+        vector<int> open_constraints;
+        for (int variable = 0; variable < variable_count; ++variable) {
+            vector<int> next_open_constraints;
+            for (size_t index = 0; index < constraints.size(); ++index) {
+                if (first[index] > variable || last[index] < variable) {
+                    continue;
+                }
+                const SparseRow& row = constraints[index];
+                FrontierTransition transition;
+                auto position = std::find(open_constraints.begin(), open_constraints.end(), (int)index);
+                transition.source = position == open_constraints.end() ? -1 : position - open_constraints.begin();
+                transition.value = row.value;
+                transition.contains = Coefficient(row, variable) != 0;
+                transition.cells_after = 0;
+                for (auto [next_variable, coefficient]: row.entries) {
+                    assert(coefficient == 1);
+                    transition.cells_after += next_variable > variable;
+                }
+                if (last[index] == variable) {
+                    closed[variable].push_back(transition);
+                } else {
+                    opened[variable].push_back(transition);
+                    next_open_constraints.push_back(index);
+                }
+            }
+            open_constraints.swap(next_open_constraints);
+        }
+
+        // Returns whether assigning `value` to `variable` from `state` is valid, and writes the next state.
+        auto transit = [&](int variable, const std::string& state, int value, std::string& next_state) {
+            for (const auto& transition: closed[variable]) {
+                int remaining = (transition.source == -1 ? transition.value : state[transition.source]) - (transition.contains ? value : 0);
+                if (remaining != 0) {
+                    return false;
+                }
+            }
+            next_state.clear();
+            for (const auto& transition: opened[variable]) {
+                int remaining = (transition.source == -1 ? transition.value : state[transition.source]) - (transition.contains ? value : 0);
+                if (remaining < 0 || remaining > transition.cells_after) {
+                    return false;
+                }
+                next_state.push_back((char)remaining);
+            }
+            return true;
+        };
+
+        Value one;
+        SetOne(one);
+
+        using Layer = std::unordered_map<std::string, Value>;
+        std::string next_state;
+        // Adds the states reached from `layer` by assigning `variable` into `next_layer`.
+        auto advance = [&](int variable, const Layer& layer, Layer& next_layer) {
+            for (const auto& [state, ways]: layer) {
+                for (int value = 0; value <= 1; ++value) {
+                    if (transit(variable, state, value, next_state)) {
+                        AddShifted(next_layer[next_state], ways, value);
+                    }
+                }
+            }
+        };
+
+        // Only every `interval`-th forward layer is kept; the backward pass recomputes the others one block at a time.
+        int interval = std::max(1, (int)std::ceil(std::sqrt((double)variable_count)));
+        vector<Layer> checkpoints;
+        Layer layer, next_layer;
+        layer.emplace(std::string(), one);
+        for (int variable = 0; variable < variable_count; ++variable) {
+            if (timer.TimeIsUp()) {
+                if (kPrintDebugInfo) {
+                    std::cerr << "CountMineByFrontier Timeout!" << std::endl;
+                }
+                return {};
+            }
+            if (variable % interval == 0) {
+                checkpoints.push_back(layer);
+            }
+            next_layer.clear();
+            advance(variable, layer, next_layer);
+            if (next_layer.size() > kMaxFrontierStates) {
+                if (kPrintDebugInfo) {
+                    std::cerr << "CountMineByFrontier Too Wide!" << std::endl;
+                }
+                return {};
+            }
+            layer.swap(next_layer);
+        }
+
+        Value legal_count;
+        auto last_layer = layer.find(std::string());
+        if (last_layer != layer.end()) {
+            legal_count = last_layer->second;
+        }
+        vector<Value> count(variable_count);
+        if (IsZero(legal_count)) {
+            return {legal_count, count};
+        }
+
+        Layer backward, next_backward;
+        backward.emplace(std::string(), one);
+        vector<Layer> block(interval);
+        for (int begin = (variable_count - 1) / interval * interval; begin >= 0; begin -= interval) {
+            int end = std::min(begin + interval, variable_count);
+            block[0].swap(checkpoints[begin / interval]);
+            Layer().swap(checkpoints[begin / interval]);
+            for (int variable = begin + 1; variable < end; ++variable) {
+                block[variable - begin].clear();
+                advance(variable - 1, block[variable - begin - 1], block[variable - begin]);
+            }
+            for (int variable = end - 1; variable >= begin; --variable) {
+                if (timer.TimeIsUp()) {
+                    if (kPrintDebugInfo) {
+                        std::cerr << "CountMineByFrontier Timeout!" << std::endl;
+                    }
+                    return {};
+                }
+                next_backward.clear();
+                for (const auto& [state, ways]: block[variable - begin]) {
+                    Value completions;
+                    for (int value = 0; value <= 1; ++value) {
+                        if (!transit(variable, state, value, next_state)) {
+                            continue;
+                        }
+                        auto it = backward.find(next_state);
+                        if (it == backward.end()) {
+                            continue;
+                        }
+                        AddShifted(completions, it->second, value);
+                        if (value == 1) {
+                            AddProduct(count[variable], ways, it->second, 1);
+                        }
+                    }
+                    if (!IsZero(completions)) {
+                        next_backward.emplace(state, completions);
+                    }
+                }
+                backward.swap(next_backward);
+            }
+        }
+        return {legal_count, count};
+    }
+
+    // See CountByFrontier().
+    std::pair<BigUnsigned, vector<BigUnsigned>> CountMineByFrontier(const SparseMatrix& constraints, int variable_count, Timer& timer) {
+        return CountByFrontier<BigUnsigned>(constraints, variable_count, timer);
+    }
+
+    // Same as CountMineByFrontier(), with every count grouped by the number of mines the region uses.
+    std::pair<MinePolynomial, vector<MinePolynomial>> CountMineByFrontierGrouped(const SparseMatrix& constraints, int variable_count, Timer& timer) {
+        return CountByFrontier<MinePolynomial>(constraints, variable_count, timer);
+    }
+}
+
+#endif
@@ -1,270 +1,787 @@
-#ifndef MINEALGO_MS_GENERATE_H_
-#define MINEALGO_MS_GENERATE_H_
-
-#include <algorithm>
-#include <atomic>
-#include <cassert>
-#include <functional>
-#include <future>
-#include <iostream>
-#include <vector>
-
-#include "ms_board.h"
-#include "ms_solve.h"
-#include "ms_timer.h"
-
-namespace ms_algo {
-    enum RestrictionType {
-        kUnrestricted,
-        kIsMine,
-        kNotMine,
-    };
-
-    enum GenerateType {
-        kNormal,
-        kSolvable,
-    };
-
-    // (Do not call this function directly) Generates a game board randomly.
-    std::pair<bool, Board> GenerateNormal(
-        int row_count,
-        int column_count,
-        int random_mine_count,
-        Matrix<RestrictionType> restriction
-    ) {
-        if (kPrintDebugInfo) {
-            std::clog << "GenerateNormal " << row_count << " x " << column_count << " : " << random_mine_count << std::endl;
-        }
-
-        Board result(row_count, column_count);
-        vector<std::pair<int, int>> grids;
-        for (int row = 1; row <= row_count; ++row) {
-            for (int column = 1; column <= column_count; ++column) {
-                switch (restriction[row][column]) {
-                case RestrictionType::kUnrestricted:
-                    grids.emplace_back(row, column);
-                    break;
-                case RestrictionType::kIsMine:
-                    random_mine_count -= 1;
-                    result.get_grid_ref(row, column).set_is_mine();
-                    break;
-                default:
-                    break;
-                }
-            }
-        }
-        if (random_mine_count < 0 || random_mine_count > (int)grids.size()) {
-            return {false, result};
-        }
-        ShuffleVector(grids);
-        for (int i = 0; i < random_mine_count; ++i) {
-            auto [row, column] = grids[i];
-            result.get_grid_ref(row, column).set_is_mine();
-        }
-        result.Refresh();
-        return {true, result};
-    }
-
-    // (Do not call this function directly) Tries to generate a solvable game board.
-    std::pair<bool, Board> TryGenerateSolvable(
-        int row_count,
-        int column_count,
-        int random_mine_count,
-        const Board& initial_board,
-        vector<std::pair<int, int>> grids,
-        Timer& timer
-    ) {
-        if (kPrintDebugInfo) {
-            std::clog << "TryGenerateSolvable: " << row_count << " x " << column_count << " : " << random_mine_count << std::endl;
-            std::clog << "Grids: " << grids.size() << 'x' << std::endl;
-            for (auto [row, column]: grids) {
-                std::clog << '(' << row << ", " << column << ") ";
-            }
-            std::clog << std::endl;
-        }
-
-        while(!timer.TimeIsUp()) {
-            Board result(initial_board);
-            ShuffleVector(grids);
-            for (int i = 0; i < random_mine_count; ++i) {
-                auto [row, column] = grids[i];
-                result.get_grid_ref(row, column).set_is_mine();
-            }
-            result.Refresh();
-            if (Solvable(result, timer)) {
-                timer.Terminate();
-                return {true, result};
-            }
-        }
-        if (kPrintDebugInfo) {
-            std::clog << "TryGenerateSolvable Timeout!" << std::endl;
-        }
-        return {};
-    }
-
-    // (Do not call this function directly) Calls TryGenerateSolvable() in multiple threads
-    std::pair<bool, Board> GenerateSolvable(
-        int row_count,
-        int column_count,
-        int time_limit_milliseconds,
-        int random_mine_count,
-        int thread_count,
-        Matrix<RestrictionType> restriction,
-        Matrix<GridState> gridstate
-    ) {
-        if (kPrintDebugInfo) {
-            std::clog << "GenerateSolvable: " << row_count << " x " << column_count << std::endl;
-            std::clog << "TimeLimit: " << time_limit_milliseconds << "ms" << std::endl;
-            std::clog << "RandomMine: " << random_mine_count << std::endl;
-            std::clog << "Thread: " << thread_count << 'x' << std::endl;
-
-            std::clog << "\nRestriction: " << std::endl;
-            for (int row = 1; row <= row_count; ++row) {
-                for (int column = 1; column <= column_count; ++column) {
-                    std::clog << restriction[row][column];
-                }
-                std::clog << std::endl;
-            }
-
-            std::clog << "\nGridState: " << std::endl;
-            for (int row = 1; row <= row_count; ++row) {
-                for (int column = 1; column <= column_count; ++column) {
-                    std::clog << gridstate[row][column];
-                }
-                std::clog << std::endl;
-            }
-        }
-
-        Timer timer(time_limit_milliseconds);
-
-        Board initial_board(row_count, column_count);
-        vector<std::pair<int, int>> grids;
-        for (int row = 1; row <= row_count; ++row) {
-            for (int column = 1; column <= column_count; ++column) {
-                switch (restriction[row][column])
-                {
-                case RestrictionType::kIsMine:
-                    initial_board.get_grid_ref(row, column).set_is_mine();
-                    break;
-                case RestrictionType::kUnrestricted:
-                    grids.emplace_back(row, column);
-                    break;
-                default:
-                    break;
-                }
-                initial_board.get_grid_ref(row, column).set_state(gridstate[row][column]);
-            }
-        }
-
-        vector<std::future<std::pair<bool, Board>>> results(thread_count);
-        for (auto &result: results) {
-            result = std::async(TryGenerateSolvable, row_count, column_count, random_mine_count, std::cref(initial_board), grids, std::ref(timer));
-        }
-
-        for (auto &result: results) {
-            auto [result_state, board] = result.get();
-            if (result_state) {
-                if (kPrintDebugInfo) {
-                    std::clog << "GenerateSolvable Succeed!" << std::endl;
-                }
-                return {true, board};
-            }
-        }
-        return {false, {}};
-    }
-
-    /**
-        @brief Generates a game board according to the arguments.
-        @param row_count The number of rows.
-        @param column_count The number of columns.
-        @param restriction The restriction of the board, 'RestrictionType::kUnrestricted', 'RestrictionType::kIsMine' or 'RestrictionType::kNotMine'.
-        @param gridstate The state of the board, 'GridState::kUnknown', 'GridState::kOpened' or 'GridState::kFlaged'.
-        @param type The type of board to be generated, completely random by `GenerateType::kNormal` and solvable without any guess by `GenerateType::kSolvable`.
-        @param time_limit_milliseconds The time limitation, default by 1000 ms. (May not be accurate)
-        @param random_mine_count The number of mines to be added into the board.
-        @param restriction The restrictions of the board.
-    */
-    std::pair<bool, Board> Generate(
-        int row_count,
-        int column_count,
-        Matrix<RestrictionType> restriction,
-        Matrix<GridState> gridstate,
-        GenerateType type = GenerateType::kNormal,
-        int time_limit_milliseconds = 1000,
-        int thread_count = 1,
-        int random_mine_count = 0
-    ) {
-        assert(1 <= row_count && row_count <= kMaxRowCount);
-        assert(1 <= column_count && column_count <= kMaxColumnCount);
-
-        assert((int)restriction.size() == row_count + 1);
-        assert((int)gridstate.size() == row_count + 1);
-        for (int row = 1; row <= row_count; ++row) {
-            assert((int)restriction[row].size() == column_count + 1);
-            assert((int)gridstate[row].size() == column_count + 1);
-        }
-        assert(1 <= time_limit_milliseconds && time_limit_milliseconds <= kMaxTimeLimitMilliseconds);
-        assert(1 <= thread_count && thread_count <= kMaxThreadCount);
-
-        int max_random_mine_count = 0;
-        for (int row = 1; row <= row_count; ++row) {
-            for (int column = 1; column <= column_count; ++column) {
-                if (restriction[row][column] == RestrictionType::kUnrestricted) {
-                    ++max_random_mine_count;
-                }
-            }
-        }
-        if (random_mine_count == 0) {
-            random_mine_count = std::min(int(row_count * column_count * 0.15), max_random_mine_count / 4);
-        }
-        assert(0 <= random_mine_count && random_mine_count <= max_random_mine_count);
-        if (type == GenerateType::kNormal) {
-            return GenerateNormal(row_count, column_count, random_mine_count, restriction);
-        } else {
-            return GenerateSolvable(row_count, column_count, time_limit_milliseconds, random_mine_count, thread_count, restriction, gridstate);
-        }
-    }
-
-    /**
-        @brief Generates a game board according to the arguments.
-        @param row_count The number of rows.
-        @param column_count The number of columns.
-        @param start_row The row of the starting position guaranteed not to be mine. 0 means no limitation.
-        @param start_column The column of the starting position guaranteed not to be mine. 0 means no limitation.
-        @param type The type of board to be generated, completely random by `GenerateType::kNormal` and solvable without any guess by `GenerateType::kSolvable`.
-        @param time_limit_milliseconds The time limitation, default by 1000 ms. (May not be accurate)
-        @param thread_count Enables multithreading by greater than 1.
-        @param random_mine_count The number of mines to be added into the board.
-    */
-    std::pair<bool, Board> Generate(
-        int row_count,
-        int column_count,
-        int start_row,
-        int start_column,
-        GenerateType type = GenerateType::kNormal,
-        int time_limit_milliseconds = 1000,
-        int thread_count = 1,
-        int random_mine_count = 0
-    ) {
-        assert(1 <= row_count && row_count <= kMaxRowCount);
-        assert(1 <= column_count && column_count <= kMaxColumnCount);
-
-        if (start_row == 0) {
-            start_row = RandInteger(0, row_count) + 1;
-        }
-        if (start_column == 0) {
-            start_column = RandInteger(0, column_count) + 1;
-        }
-
-        assert(1 <= start_row && start_row <= row_count);
-        assert(1 <= start_column && start_column <= column_count);
-
-        Matrix<RestrictionType> restriction(row_count + 1, vector<RestrictionType>(column_count + 1, RestrictionType::kUnrestricted));
-        Matrix<GridState> gridstate(row_count + 1, vector<GridState>(column_count + 1, GridState::kUnknown));
-        restriction[start_row][start_column] = RestrictionType::kNotMine;
-        gridstate[start_row][start_column] = GridState::kOpened;
-        return Generate(row_count, column_count, restriction, gridstate, type, time_limit_milliseconds, thread_count, random_mine_count);
-    }
-}
-
+#ifndef MINEALGO_MS_GENERATE_H_
+#define MINEALGO_MS_GENERATE_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "ms_bitboard.h"
+#include "ms_board.h"
+#include "ms_solve.h"
+#include "ms_thread_pool.h"
+#include "ms_timer.h"
+
+namespace ms_algo {
+    enum RestrictionType {
+        kUnrestricted,
+        kIsMine,
+        kNotMine,
+    };
+
+    enum GenerateType {
+        kNormal,
+        kSolvable,
+
+        // Solvable, by repairing the boards where solving gets stuck instead of drawing new ones (see TryGenerateRepaired()).
+        kRepair,
+
+        // Solvable, by clearing a constraint wherever solving gets stuck, so that each fix unblocks it (see TryGenerateConstructive()).
+        kConstructive,
+    };
+
+    /**
+        @brief Places mines on a uniform sample of `grids`, drawn from `seed` alone, and records the seed in the board.
+        @param grids The candidate grids, in the same order whenever the board should be reproducible. They are reordered.
+        @param mines If not null, a bit board holding the mines of `board`, whose mine plane gets the new mines too.
+    */
+    void PlaceRandomMines(Board& board, vector<std::pair<int, int>>& grids, int random_mine_count, uint64_t seed, BitBoard* mines = nullptr) {
+        Xoshiro256 generator(seed);
+        generator.SampleToFront(grids, random_mine_count);
+        for (int i = 0; i < random_mine_count; ++i) {
+            auto [row, column] = grids[i];
+            board.get_grid_ref(row, column).set_is_mine();
+            if (mines != nullptr) {
+                mines->set_is_mine(row, column);
+            }
+        }
+        board.set_seed(seed);
+    }
+
+    /**
+        The mine planes of the attempts of a generation call. After Load(), each attempt starts from Reset(), which gives
+        the bit board of the thread with the mines of the initial board, for PlaceRandomMines() and RefreshMineCounts():
+        the counts are then computed without reading the mines back from the board. Without kUseBitBoard it does nothing.
+    */
+    class AttemptMines {
+    private:
+        int row_count_ = 0;
+        int column_count_ = 0;
+        vector<uint64_t> initial_;
+
+    public:
+        void Load(const Board& initial_board) {
+            if (kUseBitBoard) {
+                row_count_ = initial_board.row_count();
+                column_count_ = initial_board.column_count();
+                BitBoard& bit_board = ThreadBitBoard();
+                bit_board.LoadMines(initial_board);
+                initial_ = bit_board.mines();
+            }
+        }
+
+        // Returns the bit board to place the mines of an attempt in, or null without kUseBitBoard. It is the bit board
+        // of the thread, so it only holds until the counts are refreshed.
+        BitBoard* Reset() {
+            if (!kUseBitBoard) {
+                return nullptr;
+            }
+            BitBoard& bit_board = ThreadBitBoard();
+            bit_board.set_mines(row_count_, column_count_, initial_);
+            return &bit_board;
+        }
+    };
+
+    // The seed of the `attempt`-th board tried by GenerateSolvable() with `seed`. The first one uses `seed` itself.
+    uint64_t AttemptSeed(uint64_t seed, uint64_t attempt) {
+        return attempt == 0 ? seed : DeriveSeed(seed, attempt);
+    }
+
+    // (Do not call this function directly) Generates a game board randomly.
+    std::pair<bool, Board> GenerateNormal(
+        int row_count,
+        int column_count,
+        int random_mine_count,
+        Matrix<RestrictionType> restriction,
+        uint64_t seed
+    ) {
+        if (kPrintDebugInfo) {
+            std::clog << "GenerateNormal " << row_count << " x " << column_count << " : " << random_mine_count << std::endl;
+        }
+
+        Board result(row_count, column_count);
+        vector<std::pair<int, int>> grids;
+        for (int row = 1; row <= row_count; ++row) {
+            for (int column = 1; column <= column_count; ++column) {
+                switch (restriction[row][column]) {
+                case RestrictionType::kUnrestricted:
+                    grids.emplace_back(row, column);
+                    break;
+                case RestrictionType::kIsMine:
+                    random_mine_count -= 1;
+                    result.get_grid_ref(row, column).set_is_mine();
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+        if (random_mine_count < 0 || random_mine_count > (int)grids.size()) {
+            return {false, result};
+        }
+        PlaceRandomMines(result, grids, random_mine_count, seed);
+        RefreshMineCounts(result);
+        return {true, result};
+    }
+
+    // The attempts of one GenerateSolvable() call, shared by its tasks.
+    struct SolvableAttempts {
+        // The number of the next attempt. Attempt `i` places its mines with AttemptSeed(seed, i).
+        std::atomic<uint64_t> next{0};
+
+        // The lowest attempt found solvable so far. Attempts after it are not started.
+        std::atomic<uint64_t> first_success{std::numeric_limits<uint64_t>::max()};
+
+        void Succeed(uint64_t attempt) {
+            uint64_t current = first_success;
+            while (attempt < current && !first_success.compare_exchange_weak(current, attempt)) {}
+        }
+    };
+
+    // Returns the number of neighbours of a grid inside the board.
+    int NeighbourCount(const Board& board, int row, int column) {
+        int rows = 3 - (row == 1) - (row == board.row_count());
+        int columns = 3 - (column == 1) - (column == board.column_count());
+        return rows * columns - 1;
+    }
+
+    // Returns a mask of the neighbours of a grid inside the board and not mine, bit `d` for direction `d` of kRowOffset.
+    uint8_t SafeNeighbourMask(const Board& board, int row, int column) {
+        uint8_t mask = 0;
+        for (int direction = 0; direction < 8; ++direction) {
+            int next_row = row + kRowOffset[direction], next_column = column + kColumnOffset[direction];
+            if (board.Inside(next_row, next_column) && !board.get_grid(next_row, next_column).is_mine()) {
+                mask |= 1 << direction;
+            }
+        }
+        return mask;
+    }
+
+    /**
+        @brief Returns whether an unknown grid which is not mine has only mines around it.
+
+        No grid next to it can be opened, so it is in no constraint, and only the total number of mines could
+        ever tell it is safe. Such a board is never solvable without SolveOptions::use_mine_count.
+        Reads the mine counts, so the board must be refreshed.
+    */
+    bool HasEnclosedSafeGrid(const Board& board) {
+        for (int row = 1; row <= board.row_count(); ++row) {
+            for (int column = 1; column <= board.column_count(); ++column) {
+                Grid grid = board.get_grid(row, column);
+                if (grid.IsUnknown() && !grid.is_mine() && grid.mine_count() == NeighbourCount(board, row, column)
+                    && grid.mine_count() != 0) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /**
+        @brief Returns whether an unknown mine and an unknown safe grid at most 2 apart cannot be told apart.
+
+        Swapping them only changes the numbers of the grids next to exactly one of them. If all those grids
+        are mines, no number that can ever be opened changes, and the total number of mines does not either.
+        Whatever is opened, the swapped board shows the same, so neither grid can be deduced before the other
+        is, and the board is never solvable. This catches the 50/50s of corners, edges and walls of mines.
+        Reads the mine counts, so the board must be refreshed.
+    */
+    bool HasIndistinguishablePair(const Board& board) {
+        // Offsets within 2 are numbered (row_offset + 2) * 5 + column_offset + 2, so offset 24 - k is the opposite of k.
+        // `apart[k]` has the directions around a grid further than 1 from the grid at offset k, and `admissible[mask]`
+        // the offsets at which a mine could be indistinguishable from a grid with safe neighbours `mask`.
+        struct Tables {
+            std::array<uint8_t, 25> apart{};
+            std::array<uint32_t, 256> admissible{};
+        };
+        static const Tables tables = [] {
+            Tables result;
+            for (int offset = 0; offset < 25; ++offset) {
+                for (int direction = 0; direction < 8; ++direction) {
+                    if (std::abs(kRowOffset[direction] - (offset / 5 - 2)) > 1 || std::abs(kColumnOffset[direction] - (offset % 5 - 2)) > 1) {
+                        result.apart[offset] |= 1 << direction;
+                    }
+                }
+            }
+            for (int mask = 0; mask < 256; ++mask) {
+                for (int offset = 0; offset < 25; ++offset) {
+                    if (offset != 12 && (mask & result.apart[offset]) == 0) {
+                        result.admissible[mask] |= 1u << offset;
+                    }
+                }
+            }
+            return result;
+        }();
+
+        for (int safe_row = 1; safe_row <= board.row_count(); ++safe_row) {
+            for (int safe_column = 1; safe_column <= board.column_count(); ++safe_column) {
+                Grid safe = board.get_grid(safe_row, safe_column);
+                // At most 4 neighbours of the safe grid are within 1 of the mine and not the mine itself,
+                // so most grids are passed over by their mine count alone.
+                if (!safe.IsUnknown() || safe.is_mine() || NeighbourCount(board, safe_row, safe_column) - safe.mine_count() > 4) {
+                    continue;
+                }
+                for (uint32_t offsets = tables.admissible[SafeNeighbourMask(board, safe_row, safe_column)]; offsets != 0; offsets &= offsets - 1) {
+                    int offset = CountTrailingZeros(offsets);
+                    int mine_row = safe_row + offset / 5 - 2, mine_column = safe_column + offset % 5 - 2;
+                    if (!board.Inside(mine_row, mine_column)) {
+                        continue;
+                    }
+                    Grid mine = board.get_grid(mine_row, mine_column);
+                    if (mine.IsUnknown() && mine.is_mine()
+                        && (SafeNeighbourMask(board, mine_row, mine_column) & tables.apart[24 - offset]) == 0) {
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    /**
+        @brief Rejects boards which can never be solvable, in O(R * C), counting them by filter in the counters of
+        ms_instrument.h.
+
+        Every filter is sound: it only rejects boards Solvable() would reject too, so filtering changes which
+        boards are found in no way, only how fast. A start which opens no zero is not rejected, since such
+        boards are often solvable.
+    */
+    bool Hopeless(const Board& board, const SolveOptions& options) {
+        if (!options.use_mine_count && HasEnclosedSafeGrid(board)) {
+            Count(Counter::kFilteredEnclosed);
+            return true;
+        }
+        if (HasIndistinguishablePair(board)) {
+            Count(Counter::kFilteredIndistinguishable);
+            return true;
+        }
+        return false;
+    }
+
+    // (Do not call this function directly) Tries to generate a solvable game board.
+    // The attempts reset a per-thread board and solver in place, which keep their memory between attempts and calls
+    // on a pool worker, so an attempt allocates nothing once they have grown (region cache misses aside).
+    // Attempts before the first success always run to the end, so the lowest solvable attempt wins whatever the timing.
+    std::pair<bool, Board> TryGenerateSolvable(
+        int row_count,
+        int column_count,
+        int random_mine_count,
+        const Board& initial_board,
+        const vector<std::pair<int, int>>& initial_grids,
+        uint64_t seed,
+        SolvableAttempts& attempts,
+        Timer& timer
+    ) {
+        static thread_local vector<std::pair<int, int>> grids;
+        static thread_local Board result;
+        static thread_local Solver solver;
+        static thread_local AttemptMines attempt_mines;
+
+        if (kPrintDebugInfo) {
+            std::clog << "TryGenerateSolvable: " << row_count << " x " << column_count << " : " << random_mine_count << std::endl;
+            std::clog << "Grids: " << initial_grids.size() << 'x' << std::endl;
+            for (auto [row, column]: initial_grids) {
+                std::clog << '(' << row << ", " << column << ") ";
+            }
+            std::clog << std::endl;
+        }
+
+        attempt_mines.Load(initial_board);
+
+        // Attempts keep producing the same small regions, so their results are shared between threads.
+        SolveOptions options;
+        options.region_cache = &SharedRegionCache();
+        while(!timer.TimeIsUp()) {
+            ScopedStage stage(Stage::kAttempt);
+            result = initial_board;
+            uint64_t attempt = attempts.next++;
+            if (attempt > attempts.first_success) {
+                break;
+            }
+            grids = initial_grids;
+            BitBoard* mines = attempt_mines.Reset();
+            PlaceRandomMines(result, grids, random_mine_count, AttemptSeed(seed, attempt), mines);
+            RefreshMineCounts(result, mines);
+            if (Hopeless(result, options)) {
+                continue;
+            }
+            solver.Reset(result, options);
+            if (solver.Solve(timer)) {
+                attempts.Succeed(attempt);
+                return {true, result};
+            }
+        }
+        if (kPrintDebugInfo && timer.TimeIsUp()) {
+            std::clog << "TryGenerateSolvable Timeout!" << std::endl;
+        }
+        return {};
+    }
+
+    // Returns whether a grid is next to an opened grid of the board, so that its being mine was observed.
+    bool NextToOpened(const Board& board, int row, int column) {
+        for (int next_row = row - 1; next_row <= row + 1; ++next_row) {
+            for (int next_column = column - 1; next_column <= column + 1; ++next_column) {
+                if (board.Inside(next_row, next_column) && board.get_grid(next_row, next_column).IsOpened()) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // TryGenerateRepaired() moves at most this many mines in one attempt before drawing a new board.
+    const int kMaxRepairsPerAttempt = 64;
+
+    /**
+        @brief (Do not call this function directly) Tries to generate a solvable game board by local repairs.
+
+        Each attempt places the mines like TryGenerateSolvable(), then solves until stuck. Then one mine next to
+        the opened area is moved to an unknown grid away from it, both chosen by a generator derived from the
+        attempt seed. The counts are updated in place and solving resumes where it stopped. A board solved after
+        repairs is validated by solving it again from its initial state; getting stuck there is just the next
+        place to repair. After kMaxRepairsPerAttempt repairs, or with nothing left to move, a new attempt starts.
+        Mines are only moved between unrestricted grids.
+    */
+    std::pair<bool, Board> TryGenerateRepaired(
+        int row_count,
+        int column_count,
+        int random_mine_count,
+        const Board& initial_board,
+        const vector<std::pair<int, int>>& initial_grids,
+        uint64_t seed,
+        SolvableAttempts& attempts,
+        Timer& timer
+    ) {
+        static thread_local vector<std::pair<int, int>> grids;
+        static thread_local Board result;
+        static thread_local vector<uint8_t> movable;
+        static thread_local vector<std::pair<int, int>> sources, targets;
+        static thread_local Solver solver;
+        static thread_local AttemptMines attempt_mines;
+
+        if (kPrintDebugInfo) {
+            std::clog << "TryGenerateRepaired: " << row_count << " x " << column_count << " : " << random_mine_count << std::endl;
+        }
+
+        attempt_mines.Load(initial_board);
+
+        SolveOptions options;
+        options.region_cache = &SharedRegionCache();
+        while (!timer.TimeIsUp()) {
+            ScopedStage stage(Stage::kAttempt);
+            uint64_t attempt = attempts.next++;
+            if (attempt > attempts.first_success) {
+                break;
+            }
+            result = initial_board;
+            grids = initial_grids;
+            uint64_t attempt_seed = AttemptSeed(seed, attempt);
+            BitBoard* mines = attempt_mines.Reset();
+            PlaceRandomMines(result, grids, random_mine_count, attempt_seed, mines);
+            RefreshMineCounts(result, mines);
+            movable.assign(result.cells().size(), false);
+            for (auto [row, column]: initial_grids) {
+                movable[result.Index(row, column)] = true;
+            }
+
+            Xoshiro256 generator(DeriveSeed(attempt_seed, 1));
+            solver.Reset(result, options);
+            // Whether the solver started from the initial state since the last repair.
+            bool fresh = true;
+            for (int repairs = 0; !timer.TimeIsUp() && attempt <= attempts.first_success;) {
+                if (solver.Solve(timer)) {
+                    if (fresh) {
+                        attempts.Succeed(attempt);
+                        return {true, result};
+                    }
+                    solver.Reset(result);
+                    fresh = true;
+                    continue;
+                }
+                if (repairs == kMaxRepairsPerAttempt) {
+                    break;
+                }
+
+                const Board& board = solver.board();
+                sources.clear();
+                targets.clear();
+                for (int row = 1; row <= row_count; ++row) {
+                    for (int column = 1; column <= column_count; ++column) {
+                        Grid grid = board.get_grid(row, column);
+                        if (!grid.IsUnknown() || !movable[board.Index(row, column)]) {
+                            continue;
+                        }
+                        bool next_to_opened = NextToOpened(board, row, column);
+                        if (next_to_opened && grid.is_mine()) {
+                            sources.emplace_back(row, column);
+                        } else if (!next_to_opened && !grid.is_mine()) {
+                            targets.emplace_back(row, column);
+                        }
+                    }
+                }
+                if (sources.empty() || targets.empty()) {
+                    break;
+                }
+                auto [from_row, from_column] = sources[generator.Below(sources.size())];
+                auto [to_row, to_column] = targets[generator.Below(targets.size())];
+                solver.MoveMine(from_row, from_column, to_row, to_column);
+                result.MoveMine(from_row, from_column, to_row, to_column);
+                fresh = false;
+                ++repairs;
+            }
+        }
+        if (kPrintDebugInfo && timer.TimeIsUp()) {
+            std::clog << "TryGenerateRepaired Timeout!" << std::endl;
+        }
+        return {};
+    }
+
+    /**
+        @brief (Do not call this function directly) Builds a solvable game board while solving it.
+
+        The board starts from the first click with its mines drawn uniformly, which is the same as drawing each
+        grid when it is first observed (hypergeometrically, from the mines and grids left). Whenever solving gets
+        stuck, the opened grid whose unknown neighbours hold the fewest mines (ties broken by a generator derived
+        from the attempt seed) gets those mines moved to unobserved grids. The counts are updated in place, the
+        grid then needs no more mines, and its unknown neighbours open at once when solving resumes. So every fix
+        unblocks the solve, instead of retrying whole boards. The mine count never changes. As with
+        TryGenerateRepaired(), earlier deductions may rest on counts changed since, so the result is validated by
+        solving it again from its initial state, and getting stuck there just leads to more fixes. Since those may
+        undo earlier ones, a new attempt starts after `row_count * column_count` fixes, or as soon as no opened
+        grid can be cleared.
+    */
+    std::pair<bool, Board> TryGenerateConstructive(
+        int row_count,
+        int column_count,
+        int random_mine_count,
+        const Board& initial_board,
+        const vector<std::pair<int, int>>& initial_grids,
+        uint64_t seed,
+        SolvableAttempts& attempts,
+        Timer& timer
+    ) {
+        static thread_local vector<std::pair<int, int>> grids;
+        static thread_local Board result;
+        static thread_local vector<uint8_t> movable;
+        static thread_local vector<std::pair<int, int>> sources, targets;
+        static thread_local Solver solver;
+        static thread_local AttemptMines attempt_mines;
+
+        if (kPrintDebugInfo) {
+            std::clog << "TryGenerateConstructive: " << row_count << " x " << column_count << " : " << random_mine_count << std::endl;
+        }
+
+        attempt_mines.Load(initial_board);
+
+        SolveOptions options;
+        options.region_cache = &SharedRegionCache();
+        while (!timer.TimeIsUp()) {
+            ScopedStage stage(Stage::kAttempt);
+            uint64_t attempt = attempts.next++;
+            if (attempt > attempts.first_success) {
+                break;
+            }
+            result = initial_board;
+            grids = initial_grids;
+            uint64_t attempt_seed = AttemptSeed(seed, attempt);
+            BitBoard* mines = attempt_mines.Reset();
+            PlaceRandomMines(result, grids, random_mine_count, attempt_seed, mines);
+            RefreshMineCounts(result, mines);
+            movable.assign(result.cells().size(), false);
+            for (auto [row, column]: initial_grids) {
+                movable[result.Index(row, column)] = true;
+            }
+
+            Xoshiro256 generator(DeriveSeed(attempt_seed, 1));
+            solver.Reset(result, options);
+            bool fresh = true;
+            // A pass opens grids with every fix, but re-solving from the start may get stuck again and move mines
+            // back, so the fixes of an attempt are capped by the board size.
+            for (int fixes = 0; !timer.TimeIsUp() && attempt <= attempts.first_success;) {
+                if (solver.Solve(timer)) {
+                    if (fresh) {
+                        attempts.Succeed(attempt);
+                        return {true, result};
+                    }
+                    solver.Reset(result);
+                    fresh = true;
+                    continue;
+                }
+                if (fixes == row_count * column_count) {
+                    break;
+                }
+
+                const Board& board = solver.board();
+                targets.clear();
+                for (int row = 1; row <= row_count; ++row) {
+                    for (int column = 1; column <= column_count; ++column) {
+                        Grid grid = board.get_grid(row, column);
+                        if (grid.IsUnknown() && !grid.is_mine() && movable[board.Index(row, column)] && !NextToOpened(board, row, column)) {
+                            targets.emplace_back(row, column);
+                        }
+                    }
+                }
+
+                // Finds the opened grid with the fewest unknown mines around, all movable, choosing uniformly among ties.
+                int best_count = std::numeric_limits<int>::max(), tie_count = 0;
+                std::pair<int, int> best;
+                for (int row = 1; row <= row_count; ++row) {
+                    for (int column = 1; column <= column_count; ++column) {
+                        if (!board.get_grid(row, column).IsOpened()) {
+                            continue;
+                        }
+                        int count = 0;
+                        bool all_movable = true;
+                        for (int next_row = row - 1; next_row <= row + 1; ++next_row) {
+                            for (int next_column = column - 1; next_column <= column + 1; ++next_column) {
+                                if (!board.Inside(next_row, next_column)) {
+                                    continue;
+                                }
+                                Grid next = board.get_grid(next_row, next_column);
+                                if (next.IsUnknown() && next.is_mine()) {
+                                    ++count;
+                                    all_movable &= (bool)movable[board.Index(next_row, next_column)];
+                                }
+                            }
+                        }
+                        if (count == 0 || !all_movable || count > (int)targets.size() || count > best_count) {
+                            continue;
+                        }
+                        tie_count = count < best_count ? 1 : tie_count + 1;
+                        best_count = count;
+                        if (generator.Below(tie_count) == 0) {
+                            best = {row, column};
+                        }
+                    }
+                }
+                if (tie_count == 0) {
+                    break;
+                }
+
+                sources.clear();
+                for (int next_row = best.first - 1; next_row <= best.first + 1; ++next_row) {
+                    for (int next_column = best.second - 1; next_column <= best.second + 1; ++next_column) {
+                        if (board.Inside(next_row, next_column) && board.get_grid(next_row, next_column).IsUnknown() && board.get_grid(next_row, next_column).is_mine()) {
+                            sources.emplace_back(next_row, next_column);
+                        }
+                    }
+                }
+                generator.SampleToFront(targets, sources.size());
+                for (size_t index = 0; index < sources.size(); ++index) {
+                    auto [from_row, from_column] = sources[index];
+                    auto [to_row, to_column] = targets[index];
+                    solver.MoveMine(from_row, from_column, to_row, to_column);
+                    result.MoveMine(from_row, from_column, to_row, to_column);
+                }
+                fresh = false;
+                ++fixes;
+            }
+        }
+        if (kPrintDebugInfo && timer.TimeIsUp()) {
+            std::clog << "TryGenerateConstructive Timeout!" << std::endl;
+        }
+        return {};
+    }
+
+    // (Do not call this function directly) Calls TryGenerateSolvable(), or TryGenerateRepaired() for `kRepair` and
+    // TryGenerateConstructive() for `kConstructive`, in multiple tasks on SharedThreadPool()
+    std::pair<bool, Board> GenerateSolvable(
+        int row_count,
+        int column_count,
+        int time_limit_milliseconds,
+        int random_mine_count,
+        int thread_count,
+        Matrix<RestrictionType> restriction,
+        Matrix<GridState> gridstate,
+        uint64_t seed,
+        GenerateType type = GenerateType::kSolvable
+    ) {
+        if (kPrintDebugInfo) {
+            std::clog << "GenerateSolvable: " << row_count << " x " << column_count << std::endl;
+            std::clog << "TimeLimit: " << time_limit_milliseconds << "ms" << std::endl;
+            std::clog << "RandomMine: " << random_mine_count << std::endl;
+            std::clog << "Thread: " << thread_count << 'x' << std::endl;
+
+            std::clog << "\nRestriction: " << std::endl;
+            for (int row = 1; row <= row_count; ++row) {
+                for (int column = 1; column <= column_count; ++column) {
+                    std::clog << restriction[row][column];
+                }
+                std::clog << std::endl;
+            }
+
+            std::clog << "\nGridState: " << std::endl;
+            for (int row = 1; row <= row_count; ++row) {
+                for (int column = 1; column <= column_count; ++column) {
+                    std::clog << gridstate[row][column];
+                }
+                std::clog << std::endl;
+            }
+        }
+
+        Timer timer(time_limit_milliseconds);
+
+        Board initial_board(row_count, column_count);
+        vector<std::pair<int, int>> grids;
+        for (int row = 1; row <= row_count; ++row) {
+            for (int column = 1; column <= column_count; ++column) {
+                switch (restriction[row][column])
+                {
+                case RestrictionType::kIsMine:
+                    initial_board.get_grid_ref(row, column).set_is_mine();
+                    break;
+                case RestrictionType::kUnrestricted:
+                    grids.emplace_back(row, column);
+                    break;
+                default:
+                    break;
+                }
+                initial_board.get_grid_ref(row, column).set_state(gridstate[row][column]);
+            }
+        }
+
+        // The calling thread runs the attempts no worker has started, so a busy pool does not hold it past its time limit.
+        TaskGroup group(SharedThreadPool());
+        SolvableAttempts attempts;
+        vector<std::future<std::pair<bool, Board>>> results(thread_count);
+        for (auto &result: results) {
+            result = group.Submit([&] {
+                auto try_generate = type == GenerateType::kRepair ? TryGenerateRepaired
+                    : type == GenerateType::kConstructive ? TryGenerateConstructive : TryGenerateSolvable;
+                return try_generate(row_count, column_count, random_mine_count, initial_board, grids, seed, attempts, timer);
+            });
+        }
+
+        // Every task is waited for, since they refer to this frame. Several may succeed; the lowest attempt is kept.
+        std::pair<bool, Board> found;
+        for (auto &result: results) {
+            group.Wait(result);
+            auto [result_state, board] = result.get();
+            if (result_state && board.seed() == AttemptSeed(seed, attempts.first_success)) {
+                if (kPrintDebugInfo) {
+                    std::clog << "GenerateSolvable Succeed!" << std::endl;
+                }
+                found = {true, std::move(board)};
+            }
+        }
+        return found;
+    }
+
+    /**
+        @brief Generates a game board according to the arguments.
+        @param row_count The number of rows.
+        @param column_count The number of columns.
+        @param restriction The restriction of the board, 'RestrictionType::kUnrestricted', 'RestrictionType::kIsMine' or 'RestrictionType::kNotMine'.
+        @param gridstate The state of the board, 'GridState::kUnknown', 'GridState::kOpened' or 'GridState::kFlaged'.
+        @param type The type of board to be generated, completely random by `GenerateType::kNormal` and solvable without any guess by `GenerateType::kSolvable`, `GenerateType::kRepair` or `GenerateType::kConstructive`.
+        @param time_limit_milliseconds The time limitation, default by 1000 ms. (May not be accurate)
+        @param random_mine_count The number of mines to be added into the board.
+        @param restriction The restrictions of the board.
+        @param seed The seed of the random mines, or 0 for a fresh one from NewSeed().
+
+        The board records the seed of its mines in Board::seed(). Generating again with the same arguments and that
+        seed gives the same board: `kNormal` places the mines from the seed alone, and the first board `kSolvable`
+        tries uses the seed itself (later ones derive theirs from it).
+    */
+    std::pair<bool, Board> Generate(
+        int row_count,
+        int column_count,
+        Matrix<RestrictionType> restriction,
+        Matrix<GridState> gridstate,
+        GenerateType type = GenerateType::kNormal,
+        int time_limit_milliseconds = 1000,
+        int thread_count = 1,
+        int random_mine_count = 0,
+        uint64_t seed = 0
+    ) {
+        assert(1 <= row_count && row_count <= kMaxRowCount);
+        assert(1 <= column_count && column_count <= kMaxColumnCount);
+
+        assert((int)restriction.size() == row_count + 1);
+        assert((int)gridstate.size() == row_count + 1);
+        for (int row = 1; row <= row_count; ++row) {
+            assert((int)restriction[row].size() == column_count + 1);
+            assert((int)gridstate[row].size() == column_count + 1);
+        }
+        assert(1 <= time_limit_milliseconds && time_limit_milliseconds <= kMaxTimeLimitMilliseconds);
+        assert(1 <= thread_count);
+
+        int max_random_mine_count = 0;
+        for (int row = 1; row <= row_count; ++row) {
+            for (int column = 1; column <= column_count; ++column) {
+                if (restriction[row][column] == RestrictionType::kUnrestricted) {
+                    ++max_random_mine_count;
+                }
+            }
+        }
+        if (random_mine_count == 0) {
+            random_mine_count = std::min(int(row_count * column_count * 0.15), max_random_mine_count / 4);
+        }
+        assert(0 <= random_mine_count && random_mine_count <= max_random_mine_count);
+        if (seed == 0) {
+            seed = NewSeed();
+        }
+        if (type == GenerateType::kNormal) {
+            return GenerateNormal(row_count, column_count, random_mine_count, restriction, seed);
+        } else {
+            return GenerateSolvable(row_count, column_count, time_limit_milliseconds, random_mine_count, thread_count, restriction, gridstate, seed, type);
+        }
+    }
+
+    /**
+        @brief Generates a game board according to the arguments.
+        @param row_count The number of rows.
+        @param column_count The number of columns.
+        @param start_row The row of the starting position guaranteed not to be mine. 0 means no limitation.
+        @param start_column The column of the starting position guaranteed not to be mine. 0 means no limitation.
+        @param type The type of board to be generated, completely random by `GenerateType::kNormal` and solvable without any guess by `GenerateType::kSolvable`, `GenerateType::kRepair` or `GenerateType::kConstructive`.
+        @param time_limit_milliseconds The time limitation, default by 1000 ms. (May not be accurate)
+        @param thread_count The number of attempts running at once on SharedThreadPool(). Enables multithreading by greater than 1.
+        @param random_mine_count The number of mines to be added into the board.
+        @param seed The seed of the random mines, or 0 for a fresh one from NewSeed(). A random starting position is drawn from it too,
+            so to regenerate a `kSolvable` board from Board::seed(), pass its starting position explicitly.
+    */
+    std::pair<bool, Board> Generate(
+        int row_count,
+        int column_count,
+        int start_row,
+        int start_column,
+        GenerateType type = GenerateType::kNormal,
+        int time_limit_milliseconds = 1000,
+        int thread_count = 1,
+        int random_mine_count = 0,
+        uint64_t seed = 0
+    ) {
+        assert(1 <= row_count && row_count <= kMaxRowCount);
+        assert(1 <= column_count && column_count <= kMaxColumnCount);
+
+        if (seed == 0) {
+            seed = NewSeed();
+        }
+        Xoshiro256 start_generator(DeriveSeed(seed, ~0ULL));
+        if (start_row == 0) {
+            start_row = start_generator.Below(row_count) + 1;
+        }
+        if (start_column == 0) {
+            start_column = start_generator.Below(column_count) + 1;
+        }
+
+        assert(1 <= start_row && start_row <= row_count);
+        assert(1 <= start_column && start_column <= column_count);
+
+        Matrix<RestrictionType> restriction(row_count + 1, vector<RestrictionType>(column_count + 1, RestrictionType::kUnrestricted));
+        Matrix<GridState> gridstate(row_count + 1, vector<GridState>(column_count + 1, GridState::kUnknown));
+        restriction[start_row][start_column] = RestrictionType::kNotMine;
+        gridstate[start_row][start_column] = GridState::kOpened;
+        return Generate(row_count, column_count, restriction, gridstate, type, time_limit_milliseconds, thread_count, random_mine_count, seed);
+    }
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,445 @@
+#ifndef MINEALGO_MS_INSTRUMENT_H_
+#define MINEALGO_MS_INSTRUMENT_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "ms_lib.h"
+
+// Define as 0 to compile the instrumentation out: ScopedStage and the recording functions then do nothing.
+#ifndef MINEALGO_INSTRUMENTATION
+#define MINEALGO_INSTRUMENTATION 1
+#endif
+
+namespace ms_algo {
+    using std::vector;
+
+    const bool kInstrument = MINEALGO_INSTRUMENTATION;
+
+    // The timed stages of generation and solving.
+    enum Stage {
+        // One candidate board of a solvable generator, from placing its mines to the verdict.
+        kAttempt,
+        kRefresh,
+        // Splitting the frontier into regions, by Divide() or Solver.
+        kDivide,
+        kElimination,
+        // Counting the solutions of a region left undecided by elimination, with any engine.
+        kEnumeration,
+        // One step of Solver.
+        kStep,
+        kStageCount,
+    };
+
+    enum Counter {
+        // Timers that ran out.
+        kTimeouts,
+        // Candidate boards rejected before solving by HasEnclosedSafeGrid().
+        kFilteredEnclosed,
+        // Candidate boards rejected before solving by HasIndistinguishablePair().
+        kFilteredIndistinguishable,
+        kCounterCount,
+    };
+
+    // Recorded values other than times.
+    enum Distribution {
+        kRegionsPerStep,
+        // The number of unknown grids of a region.
+        kRegionSize,
+        kDistributionCount,
+    };
+
+    const char* StageName(Stage stage) {
+        static const char* const kNames[] = {"attempt", "refresh", "divide", "elimination", "enumeration", "step"};
+        return kNames[stage];
+    }
+
+    const char* CounterName(Counter counter) {
+        static const char* const kNames[] = {"timeouts", "filtered_enclosed", "filtered_indistinguishable"};
+        return kNames[counter];
+    }
+
+    const char* DistributionName(Distribution distribution) {
+        static const char* const kNames[] = {"regions_per_step", "region_size"};
+        return kNames[distribution];
+    }
+
+    // Values by powers of two: bucket 0 holds 0, and bucket `b` holds [2^(b-1), 2^b).
+    struct HistogramSnapshot {
+        static const int kBucketCount = 65;
+
+        uint64_t count = 0;
+        uint64_t total = 0;
+        uint64_t buckets[kBucketCount] = {};
+
+        static int Bucket(uint64_t value) {
+            return value == 0 ? 0 : 64 - CountLeadingZeros(value);
+        }
+
+        double Mean() const {
+            return count == 0 ? 0.0 : (double)total / count;
+        }
+
+        // An upper bound of the percentile: the largest value of the bucket it falls in.
+        uint64_t Percentile(double percent) const {
+            uint64_t rank = (uint64_t)(percent / 100 * count + 0.5), seen = 0;
+            for (int bucket = 0; bucket < kBucketCount; ++bucket) {
+                seen += buckets[bucket];
+                if (seen >= rank && seen != 0) {
+                    return bucket == 0 ? 0 : bucket == 64 ? ~uint64_t(0) : (uint64_t(1) << bucket) - 1;
+                }
+            }
+            return 0;
+        }
+
+        void WriteJson(std::ostream& stream) const {
+            stream << "{\"count\": " << count << ", \"total\": " << total << ", \"mean\": " << Mean()
+                << ", \"p50\": " << Percentile(50) << ", \"p90\": " << Percentile(90) << ", \"p99\": " << Percentile(99)
+                << ", \"buckets\": [";
+            int last = kBucketCount - 1;
+            while (last > 0 && buckets[last] == 0) {
+                --last;
+            }
+            for (int bucket = 0; bucket <= last; ++bucket) {
+                stream << (bucket == 0 ? "" : ", ") << buckets[bucket];
+            }
+            stream << "]}";
+        }
+    };
+
+    // The instrumentation summed over all threads: counters, stage times in nanoseconds and distributions.
+    struct InstrumentationSnapshot {
+        uint64_t counters[kCounterCount] = {};
+        HistogramSnapshot stages[kStageCount];
+        HistogramSnapshot distributions[kDistributionCount];
+        uint64_t dropped_trace_events = 0;
+
+        void WriteJson(std::ostream& stream) const {
+            stream << std::fixed << std::setprecision(1) << "{\"counters\": {";
+            for (int counter = 0; counter < kCounterCount; ++counter) {
+                stream << (counter == 0 ? "" : ", ") << '"' << CounterName(Counter(counter)) << "\": " << counters[counter];
+            }
+            stream << "}, \"stages_ns\": {";
+            for (int stage = 0; stage < kStageCount; ++stage) {
+                stream << (stage == 0 ? "" : ", ") << '"' << StageName(Stage(stage)) << "\": ";
+                stages[stage].WriteJson(stream);
+            }
+            stream << "}, \"distributions\": {";
+            for (int distribution = 0; distribution < kDistributionCount; ++distribution) {
+                stream << (distribution == 0 ? "" : ", ") << '"' << DistributionName(Distribution(distribution)) << "\": ";
+                distributions[distribution].WriteJson(stream);
+            }
+            stream << "}, \"dropped_trace_events\": " << dropped_trace_events << '}' << std::defaultfloat;
+        }
+    };
+
+    /**
+        The records of one thread. Only the thread itself writes them, with relaxed loads and stores rather than atomic
+        increments, so that recording costs no more than plain arithmetic; other threads only read them, for snapshots.
+        Its trace events are guarded by a mutex that only an export contends for.
+    */
+    struct ThreadInstrumentation {
+        struct Histogram {
+            std::atomic<uint64_t> count{0};
+            std::atomic<uint64_t> total{0};
+            std::atomic<uint64_t> buckets[HistogramSnapshot::kBucketCount] = {};
+
+            void Record(uint64_t value) {
+                Add(count, 1);
+                Add(total, value);
+                Add(buckets[HistogramSnapshot::Bucket(value)], 1);
+            }
+
+            void AddTo(HistogramSnapshot& snapshot) const {
+                snapshot.count += count.load(std::memory_order_relaxed);
+                snapshot.total += total.load(std::memory_order_relaxed);
+                for (int bucket = 0; bucket < HistogramSnapshot::kBucketCount; ++bucket) {
+                    snapshot.buckets[bucket] += buckets[bucket].load(std::memory_order_relaxed);
+                }
+            }
+
+            void Clear() {
+                count.store(0, std::memory_order_relaxed);
+                total.store(0, std::memory_order_relaxed);
+                for (auto& bucket: buckets) {
+                    bucket.store(0, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        struct TraceEvent {
+            Stage stage;
+            int64_t beginning;
+            int64_t duration;
+        };
+
+        // Events kept per thread while tracing. Later ones are counted as dropped.
+        static const size_t kMaxTraceEventCount = 1 << 20;
+
+        int thread_index = 0;
+        std::atomic<uint64_t> counters[kCounterCount] = {};
+        Histogram stages[kStageCount];
+        Histogram distributions[kDistributionCount];
+
+        std::mutex trace_mutex;
+        vector<TraceEvent> trace_events;
+        std::atomic<uint64_t> dropped_trace_events{0};
+
+        static void Add(std::atomic<uint64_t>& value, uint64_t delta) {
+            value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+        }
+
+        void AddTo(InstrumentationSnapshot& snapshot) const {
+            for (int counter = 0; counter < kCounterCount; ++counter) {
+                snapshot.counters[counter] += counters[counter].load(std::memory_order_relaxed);
+            }
+            for (int stage = 0; stage < kStageCount; ++stage) {
+                stages[stage].AddTo(snapshot.stages[stage]);
+            }
+            for (int distribution = 0; distribution < kDistributionCount; ++distribution) {
+                distributions[distribution].AddTo(snapshot.distributions[distribution]);
+            }
+            snapshot.dropped_trace_events += dropped_trace_events.load(std::memory_order_relaxed);
+        }
+
+        void Clear() {
+            for (auto& counter: counters) {
+                counter.store(0, std::memory_order_relaxed);
+            }
+            for (auto& histogram: stages) {
+                histogram.Clear();
+            }
+            for (auto& histogram: distributions) {
+                histogram.Clear();
+            }
+            dropped_trace_events.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    /**
+        The records of every thread that recorded something. A thread registers on its first record and, when it
+        exits, leaves its counts and trace events to the registry. Never destroyed, so that pool threads joined
+        during static destruction can still leave theirs.
+    */
+    class InstrumentationRegistry {
+    private:
+        using TraceEvent = ThreadInstrumentation::TraceEvent;
+
+        std::mutex mutex_;
+        vector<ThreadInstrumentation*> threads_;
+        int next_thread_index_ = 1;
+
+        // What exited threads left.
+        InstrumentationSnapshot retired_;
+        vector<std::pair<int, TraceEvent>> retired_trace_events_;
+
+        // Bit 0: recording counters and histograms. Bit 1: recording trace events.
+        std::atomic<int> modes_{0};
+
+        int64_t beginning_ = Nanoseconds();
+
+    public:
+        static const int kRecording = 1;
+        static const int kTracing = 2;
+
+        static int64_t Nanoseconds() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        int modes() const {
+            return modes_.load(std::memory_order_relaxed);
+        }
+
+        void SetMode(int mode, bool enabled) {
+            if (enabled) {
+                modes_.fetch_or(mode, std::memory_order_relaxed);
+            } else {
+                modes_.fetch_and(~mode, std::memory_order_relaxed);
+            }
+        }
+
+        void Register(ThreadInstrumentation& thread) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            thread.thread_index = next_thread_index_++;
+            threads_.push_back(&thread);
+        }
+
+        void Retire(ThreadInstrumentation& thread) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            thread.AddTo(retired_);
+            {
+                std::lock_guard<std::mutex> trace_lock(thread.trace_mutex);
+                for (const TraceEvent& event: thread.trace_events) {
+                    retired_trace_events_.emplace_back(thread.thread_index, event);
+                }
+            }
+            threads_.erase(std::find(threads_.begin(), threads_.end(), &thread));
+        }
+
+        InstrumentationSnapshot Snapshot() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            InstrumentationSnapshot result = retired_;
+            for (ThreadInstrumentation* thread: threads_) {
+                thread->AddTo(result);
+            }
+            return result;
+        }
+
+        // Clears the counts and histograms. Records made meanwhile by other threads may be lost.
+        void Reset() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            retired_ = InstrumentationSnapshot();
+            for (ThreadInstrumentation* thread: threads_) {
+                thread->Clear();
+            }
+        }
+
+        void ClearTrace() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            retired_trace_events_.clear();
+            for (ThreadInstrumentation* thread: threads_) {
+                std::lock_guard<std::mutex> trace_lock(thread->trace_mutex);
+                thread->trace_events.clear();
+            }
+        }
+
+        // Writes the trace events in the Chrome trace-event format, for chrome://tracing or Perfetto.
+        void WriteChromeTrace(std::ostream& stream) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            bool first = true;
+            auto write = [&](int thread_index, const TraceEvent& event) {
+                stream << (first ? "\n" : ",\n") << "{\"name\": \"" << StageName(event.stage)
+                    << "\", \"cat\": \"minealgo\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << thread_index
+                    << ", \"ts\": " << (event.beginning - beginning_) / 1000.0 << ", \"dur\": " << event.duration / 1000.0 << '}';
+                first = false;
+            };
+            stream << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+            for (auto& [thread_index, event]: retired_trace_events_) {
+                write(thread_index, event);
+            }
+            for (ThreadInstrumentation* thread: threads_) {
+                std::lock_guard<std::mutex> trace_lock(thread->trace_mutex);
+                for (const TraceEvent& event: thread->trace_events) {
+                    write(thread->thread_index, event);
+                }
+            }
+            stream << "\n]}" << std::defaultfloat << std::endl;
+        }
+    };
+
+    InstrumentationRegistry& SharedInstrumentationRegistry() {
+        static InstrumentationRegistry* registry = new InstrumentationRegistry;
+        return *registry;
+    }
+
+    // The records of the current thread, registered on first use.
+    ThreadInstrumentation& CurrentThreadInstrumentation() {
+        struct Handle {
+            ThreadInstrumentation thread;
+
+            Handle() {
+                SharedInstrumentationRegistry().Register(thread);
+            }
+
+            ~Handle() {
+                SharedInstrumentationRegistry().Retire(thread);
+            }
+        };
+        static thread_local Handle handle;
+        return handle.thread;
+    }
+
+    // Switches the recording of counters, stage times and distributions on or off. Off by default.
+    void SetInstrumentation(bool enabled) {
+        SharedInstrumentationRegistry().SetMode(InstrumentationRegistry::kRecording, enabled);
+    }
+
+    // Switches the recording of trace events on or off, see WriteChromeTrace(). Off by default.
+    void SetTracing(bool enabled) {
+        SharedInstrumentationRegistry().SetMode(InstrumentationRegistry::kTracing, enabled);
+    }
+
+    bool InstrumentationEnabled() {
+        return kInstrument && (SharedInstrumentationRegistry().modes() & InstrumentationRegistry::kRecording);
+    }
+
+    void Count(Counter counter, uint64_t delta = 1) {
+        if (InstrumentationEnabled()) {
+            ThreadInstrumentation::Add(CurrentThreadInstrumentation().counters[counter], delta);
+        }
+    }
+
+    void RecordDistribution(Distribution distribution, uint64_t value) {
+        if (InstrumentationEnabled()) {
+            CurrentThreadInstrumentation().distributions[distribution].Record(value);
+        }
+    }
+
+    InstrumentationSnapshot TakeInstrumentationSnapshot() {
+        return SharedInstrumentationRegistry().Snapshot();
+    }
+
+    void ResetInstrumentation() {
+        SharedInstrumentationRegistry().Reset();
+    }
+
+    void WriteChromeTrace(std::ostream& stream) {
+        SharedInstrumentationRegistry().WriteChromeTrace(stream);
+    }
+
+    void ClearTrace() {
+        SharedInstrumentationRegistry().ClearTrace();
+    }
+
+    /**
+        Times a stage from its construction to its destruction, into the histogram of the stage and, while tracing,
+        as a trace event. Costs one relaxed load when both are off, and nothing when compiled out.
+    */
+    class ScopedStage {
+    private:
+        Stage stage_;
+        int modes_ = 0;
+        int64_t beginning_ = 0;
+
+    public:
+        explicit ScopedStage(Stage stage) : stage_(stage) {
+            if (kInstrument) {
+                modes_ = SharedInstrumentationRegistry().modes();
+                if (modes_ != 0) {
+                    beginning_ = InstrumentationRegistry::Nanoseconds();
+                }
+            }
+        }
+
+        ScopedStage(const ScopedStage&) = delete;
+        ScopedStage& operator=(const ScopedStage&) = delete;
+
+        ~ScopedStage() {
+            if (!kInstrument || modes_ == 0) {
+                return;
+            }
+            int64_t duration = InstrumentationRegistry::Nanoseconds() - beginning_;
+            ThreadInstrumentation& thread = CurrentThreadInstrumentation();
+            if (modes_ & InstrumentationRegistry::kRecording) {
+                thread.stages[stage_].Record(duration);
+            }
+            if (modes_ & InstrumentationRegistry::kTracing) {
+                std::lock_guard<std::mutex> lock(thread.trace_mutex);
+                if (thread.trace_events.size() < ThreadInstrumentation::kMaxTraceEventCount) {
+                    thread.trace_events.push_back({stage_, beginning_, duration});
+                } else {
+                    ThreadInstrumentation::Add(thread.dropped_trace_events, 1);
+                }
+            }
+        }
+    };
+}
+
+#endif
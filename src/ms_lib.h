@@ -1,215 +1,403 @@
-#ifndef MINEALGO_MS_LIB_H_
-#define MINEALGO_MS_LIB_H_
-
-#include <algorithm>
-#include <cassert>
-#include <chrono>
-#include <random>
-#include <thread>
-#include <utility>
-#include <vector>
-
-namespace ms_algo {
-    const bool kPrintDebugInfo = false;
-
-    using std::vector;
-
-    template<class T>
-    using Matrix = vector<vector<T>>;
-
-    template<class T>
-    vector<T> operator+(const vector<T>& lhs, const vector<T>& rhs) {
-        assert(lhs.size() == rhs.size());
-        vector<T> result(lhs);
-        for (size_t i = 0; i < lhs.size(); ++i) {
-            result[i] = result[i] + rhs[i];
-        }
-        return result;
-    }
-
-    template<class T>
-    vector<T> operator-(const vector<T>& lhs, const vector<T>& rhs) {
-        assert(lhs.size() == rhs.size());
-        vector<T> result(lhs);
-        for (size_t i = 0; i < lhs.size(); ++i) {
-            result[i] = result[i] - rhs[i];
-        }
-        return result;
-    }
-
-    template<class T>
-    vector<T> operator*(const vector<T>& lhs, const vector<T>& rhs) {
-        assert(lhs.size() == rhs.size());
-        vector<T> result(lhs);
-        for (size_t i = 0; i < lhs.size(); ++i) {
-            result[i] = result[i] * rhs[i];
-        }
-        return result;
-    }
-
-    template<class T>
-    vector<T> operator/(const vector<T>& lhs, const vector<T>& rhs) {
-        assert(lhs.size() == rhs.size());
-        vector<T> result(lhs);
-        for (size_t i = 0; i < lhs.size(); ++i) {
-            result[i] = result[i] / rhs[i];
-        }
-        return result;
-    }
-
-    template<class T>
-    vector<T>& operator+=(vector<T>& lhs, const vector<T>& rhs) {
-        lhs = lhs + rhs;
-        return lhs;
-    }
-
-    template<class T>
-    vector<T>& operator-=(vector<T>& lhs, const vector<T>& rhs) {
-        lhs = lhs - rhs;
-        return lhs;
-    }
-
-    template<class T>
-    vector<T>& operator*=(vector<T>& lhs, const vector<T>& rhs) {
-        lhs = lhs * rhs;
-        return lhs;
-    }
-
-    template<class T>
-    vector<T>& operator/=(vector<T>& lhs, const vector<T>& rhs) {
-        lhs = lhs / rhs;
-        return lhs;
-    }
-
-    template<class T>
-    vector<T> operator+(const vector<T>& lhs, const T& rhs) {
-        vector<T> result(lhs);
-        for (size_t i = 0; i < lhs.size(); ++i) {
-            result[i] = result[i] + rhs;
-        }
-        return result;
-    }
-
-    template<class T>
-    vector<T> operator-(const vector<T>& lhs, const T& rhs) {
-        vector<T> result(lhs);
-        for (size_t i = 0; i < lhs.size(); ++i) {
-            result[i] = result[i] - rhs;
-        }
-        return result;
-    }
-
-    template<class T>
-    vector<T> operator*(const vector<T>& lhs, const T& rhs) {
-        vector<T> result(lhs);
-        for (size_t i = 0; i < lhs.size(); ++i) {
-            result[i] = result[i] * rhs;
-        }
-        return result;
-    }
-
-    template<class T>
-    vector<T> operator/(const vector<T>& lhs, const T& rhs) {
-        vector<T> result(lhs);
-        for (size_t i = 0; i < lhs.size(); ++i) {
-            result[i] = result[i] / rhs;
-        }
-        return result;
-    }
-
-    template<class T>
-    vector<T>& operator+=(vector<T>& lhs, const T& rhs) {
-        lhs = std::move(lhs + rhs);
-        return lhs;
-    }
-
-    template<class T>
-    vector<T>& operator-=(vector<T>& lhs, const T& rhs) {
-        lhs = std::move(lhs - rhs);
-        return lhs;
-    }
-
-    template<class T>
-    vector<T>& operator*=(vector<T>& lhs, const T& rhs) {
-        lhs = std::move(lhs * rhs);
-        return lhs;
-    }
-
-    template<class T>
-    vector<T>& operator/=(vector<T>& lhs, const T& rhs) {
-        lhs = std::move(lhs / rhs);
-        return lhs;
-    }
-
-    const int kRowOffset[] = {-1, -1, -1, 0, 0, 1, 1, 1};
-    const int kColumnOffset[] = {-1, 0, 1, -1, 1, -1, 0, 1};
-
-    const double kEpsilon = 1e-5;
-
-    // Checks whether lhs and rhs is nearly the same.
-    bool Equal(double lhs, double rhs) {
-        return std::abs(lhs - rhs) < kEpsilon;
-    }
-
-    bool Greater(double lhs, double rhs) {
-        return lhs - rhs > kEpsilon;
-    }
-
-    bool Less(double lhs, double rhs) {
-        return rhs - lhs > kEpsilon;
-    }
-
-    bool IsZero(double x) {
-        return std::abs(x) < kEpsilon;
-    }
-
-    bool NotZero(double x) {
-        return std::abs(x) > kEpsilon;
-    }
-
-    std::chrono::steady_clock::time_point initial_clock = std::chrono::steady_clock::now();
-    std::mt19937 ms_rand(initial_clock.time_since_epoch().count());
-
-    // Generates a random integer in [l, r).
-    int RandInteger(int l, int r) {
-        assert(l < r);
-        return ms_rand() % (r - l) + l;
-    }
-
-    // Generates a random float in [l, r).
-    double RandFloat(float l, float r) {
-        assert(l < r);
-        return (double)ms_rand() / std::mt19937::max() * (r - l) + l;
-    }
-
-    int64_t GetMicroseconds() {
-        std::chrono::steady_clock::time_point current_clock = std::chrono::steady_clock::now();
-        return std::chrono::duration_cast<std::chrono::microseconds>(current_clock - initial_clock).count();
-    }
-
-    int64_t GetMilliseconds() {
-        std::chrono::steady_clock::time_point current_clock = std::chrono::steady_clock::now();
-        return std::chrono::duration_cast<std::chrono::milliseconds>(current_clock - initial_clock).count();
-    }
-
-    double GetTime() {
-        return (double)GetMicroseconds() * std::chrono::microseconds::period::num / std::chrono::microseconds::period::den;
-    }
-
-    // Shuffles a vector.
-    template<class T>
-    void ShuffleVector(vector<T>& vec) {
-        std::shuffle(vec.begin(), vec.end(), ms_rand);
-    }
-
-    const int kMaxRowCount = 50;
-    const int kMaxColumnCount = 100;
-    const int kMaxThreadCount = std::clamp((int)std::thread::hardware_concurrency(), 8, 64);
-    const int kMaxTimeLimitMilliseconds = 60 * 1000;
-
-    bool Inside(int row, int column, int row_count, int column_count) {
-        return 1 <= row && row <= row_count && 1 <= column && column <= column_count;
-    }
-}
-
+#ifndef MINEALGO_MS_LIB_H_
+#define MINEALGO_MS_LIB_H_
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <numeric>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "ms_random.h"
+
+// Define as 0 to leave the bit-plane backend of ms_bitboard.h unused and work grid by grid.
+#ifndef MINEALGO_BIT_BOARD
+#define MINEALGO_BIT_BOARD 1
+#endif
+
+namespace ms_algo {
+    const bool kPrintDebugInfo = false;
+
+    // Computes mine counts and frontiers on bit planes (see ms_bitboard.h) instead of grid by grid.
+    const bool kUseBitBoard = MINEALGO_BIT_BOARD;
+
+    using std::vector;
+
+    template<class T>
+    using Matrix = vector<vector<T>>;
+
+    const size_t kCacheLineSize = 64;
+
+    // Allocates storage aligned to the given boundary, a cache line by default.
+    template<class T, size_t Alignment = kCacheLineSize>
+    class AlignedAllocator {
+    public:
+        using value_type = T;
+
+        template<class U>
+        struct rebind {
+            using other = AlignedAllocator<U, Alignment>;
+        };
+
+        AlignedAllocator() {}
+
+        template<class U>
+        AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+        T* allocate(size_t n) {
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+        }
+
+        void deallocate(T* p, size_t) {
+            ::operator delete(p, std::align_val_t(Alignment));
+        }
+
+        template<class U>
+        bool operator==(const AlignedAllocator<U, Alignment>&) const {
+            return true;
+        }
+
+        template<class U>
+        bool operator!=(const AlignedAllocator<U, Alignment>&) const {
+            return false;
+        }
+    };
+
+    template<class T>
+    using AlignedVector = vector<T, AlignedAllocator<T>>;
+
+    // Row kernels. They work in place on raw ranges without allocating, and are written as
+    // plain loops over restrict pointers so that the compiler can vectorize them.
+
+    // y[i] += a * x[i]
+    template<class T>
+    void Axpy(T* __restrict y, const T* __restrict x, T a, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            y[i] += a * x[i];
+        }
+    }
+
+    // y[i] *= a
+    template<class T>
+    void Scale(T* __restrict y, T a, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            y[i] *= a;
+        }
+    }
+
+    // y[i] /= a, where every y[i] is a multiple of a.
+    template<class T>
+    void DivideExact(T* __restrict y, T a, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            y[i] /= a;
+        }
+    }
+
+    // y[i] = a * y[i] - b * x[i], the fraction-free elimination step.
+    template<class T>
+    void Combine(T* __restrict y, T a, const T* __restrict x, T b, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            y[i] = a * y[i] - b * x[i];
+        }
+    }
+
+#ifdef __AVX2__
+    template<>
+    void Combine<int>(int* __restrict y, int a, const int* __restrict x, int b, size_t n) {
+        size_t i = 0;
+        __m256i va = _mm256_set1_epi32(a);
+        __m256i vb = _mm256_set1_epi32(b);
+        for (; i + 8 <= n; i += 8) {
+            __m256i vy = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + i));
+            __m256i vx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+            vy = _mm256_sub_epi32(_mm256_mullo_epi32(va, vy), _mm256_mullo_epi32(vb, vx));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(y + i), vy);
+        }
+        for (; i < n; ++i) {
+            y[i] = a * y[i] - b * x[i];
+        }
+    }
+#endif
+
+    // Returns the largest absolute value in a range.
+    template<class T>
+    T MaxAbs(const T* __restrict x, size_t n) {
+        T result = 0;
+        for (size_t i = 0; i < n; ++i) {
+            result = std::max(result, x[i] < 0 ? -x[i] : x[i]);
+        }
+        return result;
+    }
+
+    // Returns the gcd of all values in a range, 0 if all of them are 0.
+    template<class T>
+    T RangeGcd(const T* x, size_t n) {
+        T result = 0;
+        for (size_t i = 0; i < n && result != 1; ++i) {
+            result = std::gcd(result, x[i]);
+        }
+        return result;
+    }
+
+    // Bit scans on 64-bit words, with the intrinsics of GCC, Clang and MSVC and a plain loop elsewhere.
+
+    // Returns the number of set bits.
+    int PopCount(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+        return (int)__popcnt64(x);
+#else
+        int result = 0;
+        for (; x != 0; x &= x - 1) {
+            ++result;
+        }
+        return result;
+#endif
+    }
+
+    // Returns the index of the lowest set bit. `x` must not be 0.
+    int CountTrailingZeros(uint64_t x) {
+        assert(x != 0);
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(x);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+        unsigned long index;
+        _BitScanForward64(&index, x);
+        return (int)index;
+#else
+        int result = 0;
+        for (; (x & 1) == 0; x >>= 1) {
+            ++result;
+        }
+        return result;
+#endif
+    }
+
+    // Returns the number of zero bits above the highest set bit. `x` must not be 0.
+    int CountLeadingZeros(uint64_t x) {
+        assert(x != 0);
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_clzll(x);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+        unsigned long index;
+        _BitScanReverse64(&index, x);
+        return 63 - (int)index;
+#else
+        int result = 0;
+        for (; (x >> 63) == 0; x <<= 1) {
+            ++result;
+        }
+        return result;
+#endif
+    }
+
+    template<class T>
+    vector<T>& operator+=(vector<T>& lhs, const vector<T>& rhs) {
+        assert(lhs.size() == rhs.size());
+        for (size_t i = 0; i < lhs.size(); ++i) {
+            lhs[i] += rhs[i];
+        }
+        return lhs;
+    }
+
+    template<class T>
+    vector<T>& operator-=(vector<T>& lhs, const vector<T>& rhs) {
+        assert(lhs.size() == rhs.size());
+        for (size_t i = 0; i < lhs.size(); ++i) {
+            lhs[i] -= rhs[i];
+        }
+        return lhs;
+    }
+
+    template<class T>
+    vector<T>& operator*=(vector<T>& lhs, const vector<T>& rhs) {
+        assert(lhs.size() == rhs.size());
+        for (size_t i = 0; i < lhs.size(); ++i) {
+            lhs[i] *= rhs[i];
+        }
+        return lhs;
+    }
+
+    template<class T>
+    vector<T>& operator/=(vector<T>& lhs, const vector<T>& rhs) {
+        assert(lhs.size() == rhs.size());
+        for (size_t i = 0; i < lhs.size(); ++i) {
+            lhs[i] /= rhs[i];
+        }
+        return lhs;
+    }
+
+    template<class T>
+    vector<T>& operator+=(vector<T>& lhs, const T& rhs) {
+        for (size_t i = 0; i < lhs.size(); ++i) {
+            lhs[i] += rhs;
+        }
+        return lhs;
+    }
+
+    template<class T>
+    vector<T>& operator-=(vector<T>& lhs, const T& rhs) {
+        for (size_t i = 0; i < lhs.size(); ++i) {
+            lhs[i] -= rhs;
+        }
+        return lhs;
+    }
+
+    template<class T>
+    vector<T>& operator*=(vector<T>& lhs, const T& rhs) {
+        for (size_t i = 0; i < lhs.size(); ++i) {
+            lhs[i] *= rhs;
+        }
+        return lhs;
+    }
+
+    template<class T>
+    vector<T>& operator/=(vector<T>& lhs, const T& rhs) {
+        for (size_t i = 0; i < lhs.size(); ++i) {
+            lhs[i] /= rhs;
+        }
+        return lhs;
+    }
+
+    template<class T>
+    vector<T> operator+(const vector<T>& lhs, const vector<T>& rhs) {
+        vector<T> result(lhs);
+        result += rhs;
+        return result;
+    }
+
+    template<class T>
+    vector<T> operator-(const vector<T>& lhs, const vector<T>& rhs) {
+        vector<T> result(lhs);
+        result -= rhs;
+        return result;
+    }
+
+    template<class T>
+    vector<T> operator*(const vector<T>& lhs, const vector<T>& rhs) {
+        vector<T> result(lhs);
+        result *= rhs;
+        return result;
+    }
+
+    template<class T>
+    vector<T> operator/(const vector<T>& lhs, const vector<T>& rhs) {
+        vector<T> result(lhs);
+        result /= rhs;
+        return result;
+    }
+
+    template<class T>
+    vector<T> operator+(const vector<T>& lhs, const T& rhs) {
+        vector<T> result(lhs);
+        result += rhs;
+        return result;
+    }
+
+    template<class T>
+    vector<T> operator-(const vector<T>& lhs, const T& rhs) {
+        vector<T> result(lhs);
+        result -= rhs;
+        return result;
+    }
+
+    template<class T>
+    vector<T> operator*(const vector<T>& lhs, const T& rhs) {
+        vector<T> result(lhs);
+        result *= rhs;
+        return result;
+    }
+
+    template<class T>
+    vector<T> operator/(const vector<T>& lhs, const T& rhs) {
+        vector<T> result(lhs);
+        result /= rhs;
+        return result;
+    }
+
+    const int kRowOffset[] = {-1, -1, -1, 0, 0, 1, 1, 1};
+    const int kColumnOffset[] = {-1, 0, 1, -1, 1, -1, 0, 1};
+
+    const double kEpsilon = 1e-5;
+
+    // Checks whether lhs and rhs is nearly the same.
+    bool Equal(double lhs, double rhs) {
+        return std::abs(lhs - rhs) < kEpsilon;
+    }
+
+    bool Greater(double lhs, double rhs) {
+        return lhs - rhs > kEpsilon;
+    }
+
+    bool Less(double lhs, double rhs) {
+        return rhs - lhs > kEpsilon;
+    }
+
+    bool IsZero(double x) {
+        return std::abs(x) < kEpsilon;
+    }
+
+    bool NotZero(double x) {
+        return std::abs(x) > kEpsilon;
+    }
+
+    std::chrono::steady_clock::time_point initial_clock = std::chrono::steady_clock::now();
+
+    // Generates a random integer in [l, r), uniformly, with the generator of the current thread.
+    int RandInteger(int l, int r) {
+        assert(l < r);
+        return l + (int)ThreadRandom().Below((uint32_t)r - (uint32_t)l);
+    }
+
+    // Generates a random float in [l, r).
+    double RandFloat(float l, float r) {
+        assert(l < r);
+        return ThreadRandom().Uniform() * (r - l) + l;
+    }
+
+    int64_t GetMicroseconds() {
+        std::chrono::steady_clock::time_point current_clock = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(current_clock - initial_clock).count();
+    }
+
+    int64_t GetMilliseconds() {
+        std::chrono::steady_clock::time_point current_clock = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::milliseconds>(current_clock - initial_clock).count();
+    }
+
+    double GetTime() {
+        return (double)GetMicroseconds() * std::chrono::microseconds::period::num / std::chrono::microseconds::period::den;
+    }
+
+    // Shuffles a vector.
+    template<class T>
+    void ShuffleVector(vector<T>& vec) {
+        ThreadRandom().Shuffle(vec);
+    }
+
+    // Only guards the flat cell index against overflow.
+    const int kMaxRowCount = 10000;
+    const int kMaxColumnCount = 10000;
+    // The default number of workers of SharedThreadPool(): one per hardware thread.
+    const int kMaxThreadCount = std::max(1, (int)std::thread::hardware_concurrency());
+    const int kMaxTimeLimitMilliseconds = 60 * 1000;
+
+    bool Inside(int row, int column, int row_count, int column_count) {
+        return 1 <= row && row <= row_count && 1 <= column && column <= column_count;
+    }
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,120 @@
+#ifndef MINEALGO_MS_PATTERN_H_
+#define MINEALGO_MS_PATTERN_H_
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+#include "ms_grid.h"
+
+namespace ms_algo {
+    /**
+        Local patterns (1-1 on an edge, 1-2, 1-2-1, ...) are deductions of two adjacent numbers alone.
+        For numbers `a` at (0, 0) and `b` at (0, 1), the grids that matter are the other 10 grids of the
+        3x4 window around them, so the pattern is keyed by which of them are unknown and how many mines
+        each number still needs. Vertical pairs use the same table with the window transposed, and every
+        rotation or reflection of a pattern is simply another key, so they are all covered.
+
+        The table is built at compile time by trying every mine layout of every unknown mask, so each entry
+        holds exactly what the two numbers force. Chains like 1-2-2-1 are found pair by pair.
+    */
+    const int kPatternCellCount = 10;
+
+    // The offsets of the window grids from `a`, for a horizontal pair.
+    constexpr std::pair<int, int> kPatternOffsets[kPatternCellCount] = {
+        {-1, -1}, {-1, 0}, {-1, 1}, {-1, 2},
+        {0, -1}, {0, 2},
+        {1, -1}, {1, 0}, {1, 1}, {1, 2},
+    };
+
+    // The window grids around `a` and around `b`.
+    constexpr uint16_t kPatternMaskA = 0b0111010111;
+    constexpr uint16_t kPatternMaskB = 0b1110101110;
+
+    // Window grids forced by a pattern, as masks over kPatternOffsets.
+    struct PatternDeduction {
+        uint16_t safe = 0;
+        uint16_t mine = 0;
+    };
+
+    const int kPatternKeyCount = (1 << kPatternCellCount) * 9 * 9;
+
+    constexpr int PatternKey(int unknown_mask, int remaining_a, int remaining_b) {
+        return (unknown_mask * 9 + remaining_a) * 9 + remaining_b;
+    }
+
+    // PopCount() of ms_lib.h for constant expressions, which the intrinsics behind it are not.
+    constexpr int ConstantPopCount(unsigned value) {
+        int result = 0;
+        for (; value != 0; value &= value - 1) {
+            ++result;
+        }
+        return result;
+    }
+
+    // Tries every mine layout of every unknown mask, and keeps the grids with the same value
+    // in all the layouts giving each pair of remaining counts.
+    constexpr std::array<PatternDeduction, kPatternKeyCount> MakePatternTable() {
+        std::array<PatternDeduction, kPatternKeyCount> table{};
+        for (int unknown_mask = 0; unknown_mask < (1 << kPatternCellCount); ++unknown_mask) {
+            uint16_t any_mine[9][9] = {}, all_mine[9][9] = {};
+            bool seen[9][9] = {};
+            for (int mines = unknown_mask;; mines = (mines - 1) & unknown_mask) {
+                int count_a = ConstantPopCount(mines & kPatternMaskA), count_b = ConstantPopCount(mines & kPatternMaskB);
+                if (!seen[count_a][count_b]) {
+                    seen[count_a][count_b] = true;
+                    all_mine[count_a][count_b] = mines;
+                }
+                any_mine[count_a][count_b] |= mines;
+                all_mine[count_a][count_b] &= mines;
+                if (mines == 0) {
+                    break;
+                }
+            }
+            for (int remaining_a = 0; remaining_a < 9; ++remaining_a) {
+                for (int remaining_b = 0; remaining_b < 9; ++remaining_b) {
+                    if (seen[remaining_a][remaining_b]) {
+                        PatternDeduction& deduction = table[PatternKey(unknown_mask, remaining_a, remaining_b)];
+                        deduction.safe = unknown_mask & ~any_mine[remaining_a][remaining_b];
+                        deduction.mine = all_mine[remaining_a][remaining_b];
+                    }
+                }
+            }
+        }
+        return table;
+    }
+
+    inline constexpr std::array<PatternDeduction, kPatternKeyCount> kPatternTable = MakePatternTable();
+
+    // Returns the offset of a window grid from `a`, for a horizontal or vertical pair.
+    constexpr std::pair<int, int> PatternOffset(int cell, bool vertical) {
+        auto [row_offset, column_offset] = kPatternOffsets[cell];
+        return vertical ? std::make_pair(column_offset, row_offset) : std::make_pair(row_offset, column_offset);
+    }
+
+    /**
+        @brief Looks up the pattern of two adjacent numbers.
+        @param vertical Whether `b` is at (1, 0) from `a` rather than at (0, 1).
+        @param state_of `state_of(row_offset, column_offset)` returns the state of the grid at that offset from `a`,
+            and kOpened outside the board.
+        @return The forced grids, empty if the window is inconsistent. Map them back with PatternOffset().
+    */
+    template<class StateOf>
+    PatternDeduction MatchPattern(int number_a, int number_b, bool vertical, StateOf&& state_of) {
+        int unknown_mask = 0, flaged_mask = 0;
+        for (int cell = 0; cell < kPatternCellCount; ++cell) {
+            auto [row_offset, column_offset] = PatternOffset(cell, vertical);
+            GridState state = state_of(row_offset, column_offset);
+            unknown_mask |= (state == GridState::kUnknown) << cell;
+            flaged_mask |= (state == GridState::kFlaged) << cell;
+        }
+        int remaining_a = number_a - ConstantPopCount(flaged_mask & kPatternMaskA);
+        int remaining_b = number_b - ConstantPopCount(flaged_mask & kPatternMaskB);
+        if (unknown_mask == 0 || remaining_a < 0 || remaining_a > 8 || remaining_b < 0 || remaining_b > 8) {
+            return {};
+        }
+        return kPatternTable[PatternKey(unknown_mask, remaining_a, remaining_b)];
+    }
+}
+
+#endif
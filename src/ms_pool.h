@@ -0,0 +1,449 @@
+#ifndef MINEALGO_MS_POOL_H_
+#define MINEALGO_MS_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "ms_batch.h"
+#include "ms_board.h"
+#include "ms_cache.h"
+#include "ms_generate.h"
+#include "ms_queue.h"
+#include "ms_timer.h"
+
+namespace ms_algo {
+    using std::vector;
+
+    struct PoolOptions {
+        // Boards kept per preset: a preset is refilled once it has fewer than `low_watermark`, up to `high_watermark`.
+        int low_watermark = 16;
+        int high_watermark = 64;
+
+        // The number of background threads refilling the presets.
+        int thread_count = 1;
+    };
+
+    struct PoolStatistics {
+        // Boards served from the pool, and requests left to live generation.
+        int64_t hit_count = 0;
+        int64_t miss_count = 0;
+
+        // Boards produced by the background threads, and boards they did not find in time.
+        int64_t generated_count = 0;
+        int64_t failure_count = 0;
+
+        // Boards waiting in the pool, over all presets.
+        int64_t stored_count = 0;
+
+        // Refills completed, each from the low watermark being crossed to the high one being reached again.
+        // The first filling of a preset is not counted.
+        int64_t refill_count = 0;
+        int64_t total_refill_microseconds = 0;
+        int64_t max_refill_microseconds = 0;
+
+        double HitRate() const {
+            int64_t total = hit_count + miss_count;
+            return total == 0 ? 0.0 : (double)hit_count / total;
+        }
+
+        double AverageRefillMicroseconds() const {
+            return refill_count == 0 ? 0.0 : (double)total_refill_microseconds / refill_count;
+        }
+
+        void Print(std::ostream& stream) const {
+            stream << std::fixed << std::setprecision(2);
+            stream << "hits: " << hit_count << ", misses: " << miss_count << " (hit rate " << HitRate() * 100 << "%), stored: "
+                << stored_count << ", generated: " << generated_count << ", failures: " << failure_count << std::endl;
+            stream << "refills: " << refill_count << ", lag: " << AverageRefillMicroseconds() / 1000 << " ms average, "
+                << max_refill_microseconds / 1000.0 << " ms max" << std::endl;
+            stream << std::defaultfloat;
+        }
+    };
+
+    /**
+        Keeps solvable boards of preset specs ready, so that a request for one is served in microseconds.
+        Each preset has a ring of boards (a BoundedQueue), refilled by background threads of the lowest priority with
+        hysteresis between two watermarks. Boards are kept per class of starting position up to the symmetries of the
+        board: a preset with a fixed start also serves the starts its rotations and reflections give, with the board
+        turned to match. A preset without a start serves requests without one.
+        The threads start with the first preset and stop with Shutdown() or the pool.
+    */
+    class BoardPool {
+    private:
+        struct Preset {
+            // The starting position is the smallest of its class.
+            GenerateSpec spec;
+            int random_mine_count;
+
+            // Prepared once for a fixed starting position, see GenerateFromSpec().
+            Board initial_board;
+            vector<std::pair<int, int>> initial_grids;
+
+            BoundedQueue<Board> boards;
+
+            // Boards in `boards`, and boards being generated for it.
+            std::atomic<int> size{0};
+            int in_flight = 0;
+
+            // Guarded by `mutex_`. Whether the preset is below the high watermark after crossing the low one, since when,
+            // and whether it was ever full.
+            bool refilling = true;
+            int64_t refill_beginning = 0;
+            bool filled = false;
+
+            explicit Preset(size_t capacity) : boards(capacity) {}
+        };
+
+        PoolOptions options_;
+
+        vector<std::unique_ptr<Preset>> presets_;
+        vector<std::thread> threads_;
+
+        // Guards `presets_`, the scheduling fields of the presets and starting and stopping.
+        // Idle threads sleep on `refill_needed_`.
+        std::mutex mutex_;
+        std::condition_variable refill_needed_;
+        bool stopping_ = false;
+
+        std::atomic<int64_t> hit_count_{0};
+        std::atomic<int64_t> miss_count_{0};
+        std::atomic<int64_t> generated_count_{0};
+        std::atomic<int64_t> failure_count_{0};
+        int64_t refill_count_ = 0;
+        int64_t total_refill_microseconds_ = 0;
+        int64_t max_refill_microseconds_ = 0;
+
+        // Maps a grid by one of the 8 symmetries of a square board: bit 0 transposes, bit 1 flips the rows and bit 2
+        // the columns. Transposing is only a symmetry of square boards.
+        static std::pair<int, int> Transform(int symmetry, int row_count, int column_count, int row, int column) {
+            if (symmetry & 1) {
+                std::swap(row, column);
+            }
+            if (symmetry & 2) {
+                row = row_count + 1 - row;
+            }
+            if (symmetry & 4) {
+                column = column_count + 1 - column;
+            }
+            return {row, column};
+        }
+
+        static bool Allowed(int symmetry, int row_count, int column_count) {
+            return !(symmetry & 1) || row_count == column_count;
+        }
+
+        static bool FixedStart(const GenerateSpec& spec) {
+            return spec.start_row != 0 && spec.start_column != 0;
+        }
+
+        // Returns the symmetry turning the start of `preset` into the start of `request`, or -1 if it does not serve it.
+        static int Match(const Preset& preset, const GenerateSpec& request, int random_mine_count) {
+            const GenerateSpec& spec = preset.spec;
+            if (spec.row_count != request.row_count || spec.column_count != request.column_count
+                || spec.type != request.type || preset.random_mine_count != random_mine_count) {
+                return -1;
+            }
+            if (!FixedStart(spec) || !FixedStart(request)) {
+                return spec.start_row == request.start_row && spec.start_column == request.start_column ? 0 : -1;
+            }
+            for (int symmetry = 0; symmetry < 8; ++symmetry) {
+                if (Allowed(symmetry, spec.row_count, spec.column_count)
+                    && Transform(symmetry, spec.row_count, spec.column_count, spec.start_row, spec.start_column)
+                        == std::make_pair(request.start_row, request.start_column)) {
+                    return symmetry;
+                }
+            }
+            return -1;
+        }
+
+        // Lowers the priority of the current thread to idle, so that refilling only uses otherwise idle CPUs.
+        // Only supported on Linux; elsewhere threads keep the normal priority.
+        static void LowerCurrentThreadPriority() {
+#if defined(__linux__) && defined(SCHED_IDLE)
+            sched_param parameter{};
+            pthread_setschedparam(pthread_self(), SCHED_IDLE, &parameter);
+#endif
+        }
+
+        // The number of boards a preset is refilled to. Rings keep the capacity they were made with.
+        int HighWatermark(const Preset& preset) const {
+            return std::min(options_.high_watermark, (int)preset.boards.capacity());
+        }
+
+        // Takes the preset most in need of a board: refilling, not full counting boards in progress, and with the
+        // fewest boards. Requires `mutex_`.
+        Preset* NextPresetLocked() {
+            Preset* result = nullptr;
+            for (auto& preset: presets_) {
+                if (preset->refilling && preset->size + preset->in_flight < HighWatermark(*preset)
+                    && (result == nullptr || preset->size + preset->in_flight < result->size + result->in_flight)) {
+                    result = preset.get();
+                }
+            }
+            return result;
+        }
+
+        void Work() {
+            LowerCurrentThreadPriority();
+            while (true) {
+                Preset* preset = nullptr;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    refill_needed_.wait(lock, [&] {
+                        preset = NextPresetLocked();
+                        return stopping_ || preset != nullptr;
+                    });
+                    if (stopping_) {
+                        return;
+                    }
+                    ++preset->in_flight;
+                }
+
+                Timer timer(preset->spec.time_limit_milliseconds);
+                int64_t attempt_count = 0;
+                auto [found, board] = GenerateFromSpec(preset->spec, preset->random_mine_count, NewSeed(),
+                    &preset->initial_board, &preset->initial_grids, &timer, attempt_count);
+                if (found) {
+                    bool pushed = preset->boards.TryPush(std::move(board));
+                    assert(pushed);
+                    (void)pushed;
+                    ++preset->size;
+                    ++generated_count_;
+                } else {
+                    ++failure_count_;
+                }
+
+                std::lock_guard<std::mutex> lock(mutex_);
+                --preset->in_flight;
+                if (preset->refilling && preset->size >= HighWatermark(*preset)) {
+                    preset->refilling = false;
+                    if (preset->filled) {
+                        int64_t lag = GetMicroseconds() - preset->refill_beginning;
+                        ++refill_count_;
+                        total_refill_microseconds_ += lag;
+                        max_refill_microseconds_ = std::max(max_refill_microseconds_, lag);
+                    }
+                    preset->filled = true;
+                }
+            }
+        }
+
+        // Starts the threads if they are not running. Requires `mutex_`.
+        void StartLocked() {
+            if (!threads_.empty()) {
+                return;
+            }
+            for (int index = 0; index < options_.thread_count; ++index) {
+                threads_.emplace_back(&BoardPool::Work, this);
+            }
+        }
+
+    public:
+        explicit BoardPool(const PoolOptions& options = PoolOptions()) {
+            Configure(options);
+        }
+
+        BoardPool(const BoardPool&) = delete;
+        BoardPool& operator=(const BoardPool&) = delete;
+
+        ~BoardPool() {
+            Shutdown();
+        }
+
+        // Stops the threads after the boards in progress. They start again with the next preset added.
+        void Shutdown() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            refill_needed_.notify_all();
+            for (auto& thread: threads_) {
+                thread.join();
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            threads_.clear();
+            stopping_ = false;
+        }
+
+        // Shuts the pool down and changes its options. The presets and their boards are kept, and the threads start
+        // again with the next preset added. Presets added before keep their ring, which may cap the high watermark.
+        void Configure(const PoolOptions& options) {
+            assert(0 <= options.low_watermark && options.low_watermark <= options.high_watermark);
+            assert(1 <= options.high_watermark);
+            assert(1 <= options.thread_count);
+            Shutdown();
+            std::lock_guard<std::mutex> lock(mutex_);
+            options_ = options;
+        }
+
+        /**
+            @brief Keeps boards of a spec ready, starting the threads if needed. Does nothing if a preset already serves it.
+            The spec must be of a solvable type. With a fixed start, the preset also serves every start of the same
+            class up to symmetry.
+        */
+        void AddPreset(GenerateSpec spec) {
+            assert(spec.type != GenerateType::kNormal);
+            assert(1 <= spec.row_count && spec.row_count <= kMaxRowCount);
+            assert(1 <= spec.column_count && spec.column_count <= kMaxColumnCount);
+            assert(0 <= spec.start_row && spec.start_row <= spec.row_count);
+            assert(0 <= spec.start_column && spec.start_column <= spec.column_count);
+            assert(1 <= spec.time_limit_milliseconds && spec.time_limit_milliseconds <= kMaxTimeLimitMilliseconds);
+
+            int random_mine_count = SpecMineCount(spec);
+            assert(0 <= random_mine_count && random_mine_count < spec.row_count * spec.column_count);
+            if (FixedStart(spec)) {
+                std::pair<int, int> start = {spec.start_row, spec.start_column};
+                for (int symmetry = 0; symmetry < 8; ++symmetry) {
+                    if (Allowed(symmetry, spec.row_count, spec.column_count)) {
+                        start = std::min(start, Transform(symmetry, spec.row_count, spec.column_count, spec.start_row, spec.start_column));
+                    }
+                }
+                std::tie(spec.start_row, spec.start_column) = start;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto& preset: presets_) {
+                if (Match(*preset, spec, random_mine_count) != -1) {
+                    return;
+                }
+            }
+            auto preset = std::make_unique<Preset>(options_.high_watermark);
+            preset->spec = spec;
+            preset->random_mine_count = random_mine_count;
+            preset->refill_beginning = GetMicroseconds();
+            if (FixedStart(spec)) {
+                PrepareStart(spec.row_count, spec.column_count, spec.start_row, spec.start_column,
+                    preset->initial_board, preset->initial_grids);
+            }
+            presets_.push_back(std::move(preset));
+            StartLocked();
+            refill_needed_.notify_all();
+        }
+
+        /**
+            @brief Takes a ready board for a request, turned to its starting position. Returns whether there was one.
+            A board turned by a symmetry other than the identity has its Board::seed() cleared, since its seed gives
+            the board before turning.
+        */
+        bool Take(const GenerateSpec& request, Board& board) {
+            int random_mine_count = SpecMineCount(request);
+            Preset* preset = nullptr;
+            int symmetry = -1;
+            // Read with the presets, since Configure() may change it meanwhile.
+            int low_watermark;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                low_watermark = options_.low_watermark;
+                for (auto& candidate: presets_) {
+                    symmetry = Match(*candidate, request, random_mine_count);
+                    if (symmetry != -1) {
+                        preset = candidate.get();
+                        break;
+                    }
+                }
+            }
+            static thread_local Board stored;
+            if (preset == nullptr || !preset->boards.TryPop(stored)) {
+                ++miss_count_;
+                return false;
+            }
+            ++hit_count_;
+            if (--preset->size < low_watermark) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!preset->refilling) {
+                    preset->refilling = true;
+                    preset->refill_beginning = GetMicroseconds();
+                    refill_needed_.notify_all();
+                }
+            }
+
+            if (symmetry == 0) {
+                std::swap(board, stored);
+                return true;
+            }
+            int row_count = stored.row_count(), column_count = stored.column_count();
+            board.Resize(row_count, column_count);
+            for (int row = 1; row <= row_count; ++row) {
+                for (int column = 1; column <= column_count; ++column) {
+                    // Mine counts are kept by any symmetry, so grids are copied whole.
+                    auto [next_row, next_column] = Transform(symmetry, row_count, column_count, row, column);
+                    board.set_grid(next_row, next_column, stored.get_grid(row, column));
+                }
+            }
+            board.set_seed(0);
+            return true;
+        }
+
+        /**
+            @brief Generate() by starting position, served from the pool when a preset has a board ready, and generated
+            live otherwise. The arguments are those of Generate(), without the seed: boards of the pool come from fresh
+            seeds, so a reproducible board is generated with Generate() itself.
+        */
+        std::pair<bool, Board> Generate(
+            int row_count,
+            int column_count,
+            int start_row,
+            int start_column,
+            GenerateType type = GenerateType::kSolvable,
+            int time_limit_milliseconds = 1000,
+            int thread_count = 1,
+            int random_mine_count = 0
+        ) {
+            GenerateSpec request;
+            request.row_count = row_count;
+            request.column_count = column_count;
+            request.start_row = start_row;
+            request.start_column = start_column;
+            request.random_mine_count = random_mine_count;
+            request.type = type;
+            std::pair<bool, Board> result;
+            if (type != GenerateType::kNormal && Take(request, result.second)) {
+                result.first = true;
+                return result;
+            }
+            return ms_algo::Generate(row_count, column_count, start_row, start_column, type, time_limit_milliseconds, thread_count, random_mine_count);
+        }
+
+        PoolStatistics statistics() {
+            PoolStatistics result;
+            result.hit_count = hit_count_;
+            result.miss_count = miss_count_;
+            result.generated_count = generated_count_;
+            result.failure_count = failure_count_;
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto& preset: presets_) {
+                result.stored_count += preset->size;
+            }
+            result.refill_count = refill_count_;
+            result.total_refill_microseconds = total_refill_microseconds_;
+            result.max_refill_microseconds = max_refill_microseconds_;
+            return result;
+        }
+    };
+
+    // The pool shared by the library. Its threads start with the first preset; call Configure() before to change them.
+    BoardPool& SharedBoardPool() {
+        // Its threads use these, so they are constructed before it and destroyed after it.
+        SharedRegionCache();
+        static BoardPool pool;
+        return pool;
+    }
+}
+
+#endif
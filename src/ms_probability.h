@@ -0,0 +1,188 @@
+#ifndef MINEALGO_MS_PROBABILITY_H_
+#define MINEALGO_MS_PROBABILITY_H_
+
+#include <cassert>
+#include <iostream>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "ms_bigint.h"
+#include "ms_board.h"
+#include "ms_count.h"
+#include "ms_grid.h"
+#include "ms_lib.h"
+#include "ms_region.h"
+#include "ms_timer.h"
+
+namespace ms_algo {
+    using std::vector;
+
+    // The mine probabilities of a board, given the total number of mines.
+    struct MineProbability {
+        // Whether the result is valid. It is not on timeout, on a region too wide to count,
+        // or if no mine layout is consistent with the board.
+        bool success = false;
+
+        // The number of mine layouts consistent with the board.
+        BigUnsigned layout_count;
+
+        // The probability of each grid to be mine, 1-based: 0 for opened grids and 1 for flaged ones.
+        Matrix<double> probabilities;
+
+        // Unknown grids which are safe in every consistent layout.
+        Positions safe_positions;
+
+        // Unknown grids which are mine in every consistent layout.
+        Positions mine_positions;
+    };
+
+    // Returns C(n, 0), ..., C(n, n).
+    vector<BigUnsigned> BinomialRow(int n) {
+        vector<BigUnsigned> result(n + 1);
+        result[0] = BigUnsigned(1);
+        for (int k = 0; k < n; ++k) {
+            result[k + 1] = result[k] * BigUnsigned(n - k);
+            result[k + 1].DivideSmall(k + 1);
+        }
+        return result;
+    }
+
+    /**
+        @brief Computes the exact mine probability of every unknown grid, taking the total number of mines into account.
+        @param states The situation of the board, as returned by Board::GetSituation().
+        @param mine_count The total number of mines, flaged ones included.
+
+        Each region is counted by CountMineByFrontierGrouped(), which groups its solutions by the number of mines
+        they use. The unknown grids outside every region (the interior) take the remaining mines in any way, so a
+        combination of region solutions using `s` mines in total weighs C(interior, mine_count - flaged - s).
+        The regions are convolved with prefix and suffix products, so each region is weighed against all the others
+        without enumerating them together.
+    */
+    MineProbability ComputeMineProbability(int row_count, int column_count, const Matrix<std::pair<GridState, int>>& states, int mine_count, Timer& timer) {
+        MineProbability result;
+        result.probabilities.assign(row_count + 1, vector<double>(column_count + 1, 0.0));
+
+        vector<Region> regions = Divide(row_count, column_count, states);
+        Matrix<uint8_t> in_region(row_count + 1, vector<uint8_t>(column_count + 1, false));
+        for (const auto& region: regions) {
+            for (auto [row, column]: region.first) {
+                in_region[row][column] = true;
+            }
+        }
+        Positions interior_positions;
+        int remaining_mine_count = mine_count;
+        for (int row = 1; row <= row_count; ++row) {
+            for (int column = 1; column <= column_count; ++column) {
+                if (states[row][column].first == GridState::kFlaged) {
+                    --remaining_mine_count;
+                    result.probabilities[row][column] = 1.0;
+                } else if (states[row][column].first == GridState::kUnknown && !in_region[row][column]) {
+                    interior_positions.emplace_back(row, column);
+                }
+            }
+        }
+        if (remaining_mine_count < 0) {
+            return result;
+        }
+
+        int region_count = regions.size();
+        vector<MinePolynomial> region_ways(region_count);
+        vector<vector<MinePolynomial>> grid_ways(region_count);
+        for (int index = 0; index < region_count; ++index) {
+            std::tie(region_ways[index], grid_ways[index]) = CountMineByFrontierGrouped(regions[index].second, regions[index].first.size(), timer);
+            if (IsZero(region_ways[index])) {
+                return result;
+            }
+        }
+
+        // prefix[i] combines regions [0, i), suffix[i] combines regions [i, region_count).
+        vector<MinePolynomial> prefix(region_count + 1), suffix(region_count + 1);
+        SetOne(prefix[0]);
+        SetOne(suffix[region_count]);
+        for (int index = 0; index < region_count; ++index) {
+            AddProduct(prefix[index + 1], prefix[index], region_ways[index], 0);
+        }
+        for (int index = region_count - 1; index >= 0; --index) {
+            AddProduct(suffix[index], region_ways[index], suffix[index + 1], 0);
+        }
+
+        int interior_count = interior_positions.size();
+        vector<BigUnsigned> binomials = BinomialRow(interior_count);
+        // The number of ways to place the rest of the mines in the interior, if the regions use `mines`.
+        auto interior_ways = [&](int mines) {
+            int rest = remaining_mine_count - mines;
+            return 0 <= rest && rest <= interior_count ? binomials[rest] : BigUnsigned();
+        };
+
+        const MinePolynomial& all_regions = prefix[region_count];
+        for (int mines = 0; mines < (int)all_regions.size(); ++mines) {
+            result.layout_count += all_regions[mines] * interior_ways(mines);
+        }
+        if (result.layout_count.IsZero() || timer.TimeIsUp()) {
+            return result;
+        }
+
+        for (int index = 0; index < region_count; ++index) {
+            MinePolynomial others;
+            AddProduct(others, prefix[index], suffix[index + 1], 0);
+            // weights[a]: the number of ways to complete the board if this region uses `a` mines.
+            vector<BigUnsigned> weights(region_ways[index].size());
+            for (int mines = 0; mines < (int)weights.size(); ++mines) {
+                for (int other_mines = 0; other_mines < (int)others.size(); ++other_mines) {
+                    weights[mines] += others[other_mines] * interior_ways(mines + other_mines);
+                }
+            }
+            const Region& region = regions[index];
+            for (int variable = 0; variable < (int)region.first.size(); ++variable) {
+                BigUnsigned layouts;
+                const MinePolynomial& ways = grid_ways[index][variable];
+                for (int mines = 0; mines < (int)ways.size() && mines < (int)weights.size(); ++mines) {
+                    layouts += ways[mines] * weights[mines];
+                }
+                auto [row, column] = region.first[variable];
+                result.probabilities[row][column] = Ratio(layouts, result.layout_count);
+                if (layouts.IsZero()) {
+                    result.safe_positions.emplace_back(row, column);
+                } else if (layouts == result.layout_count) {
+                    result.mine_positions.emplace_back(row, column);
+                }
+            }
+        }
+
+        if (interior_count != 0) {
+            // A given interior grid is mine in C(interior - 1, rest - 1) of the interior placements.
+            vector<BigUnsigned> interior_binomials = BinomialRow(interior_count - 1);
+            BigUnsigned layouts;
+            for (int mines = 0; mines < (int)all_regions.size(); ++mines) {
+                int rest = remaining_mine_count - mines;
+                if (1 <= rest && rest <= interior_count) {
+                    layouts += all_regions[mines] * interior_binomials[rest - 1];
+                }
+            }
+            double probability = Ratio(layouts, result.layout_count);
+            for (auto [row, column]: interior_positions) {
+                result.probabilities[row][column] = probability;
+                if (layouts.IsZero()) {
+                    result.safe_positions.emplace_back(row, column);
+                } else if (layouts == result.layout_count) {
+                    result.mine_positions.emplace_back(row, column);
+                }
+            }
+        }
+
+        if (kPrintDebugInfo) {
+            std::clog << "ComputeMineProbability: " << result.layout_count.ToString() << " layouts, "
+                << result.safe_positions.size() << " safe, " << result.mine_positions.size() << " mine" << std::endl;
+        }
+        result.success = true;
+        return result;
+    }
+
+    // Same as above, for what is visible on a board.
+    MineProbability ComputeMineProbability(const Board& board, int mine_count, Timer& timer) {
+        return ComputeMineProbability(board.row_count(), board.column_count(), board.GetSituation(), mine_count, timer);
+    }
+}
+
+#endif
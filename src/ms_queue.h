@@ -0,0 +1,146 @@
+#ifndef MINEALGO_MS_QUEUE_H_
+#define MINEALGO_MS_QUEUE_H_
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include "ms_lib.h"
+
+namespace ms_algo {
+    /**
+        A bounded multi-producer, multi-consumer queue without locks, after Dmitry Vyukov's ring.
+        Each slot has a sequence number telling whether it is ready to be written or read in the current lap, so a
+        push or pop is a compare-and-swap on its position and a release store on the slot. The capacity is rounded
+        up to a power of two. T must be default constructible and movable.
+    */
+    template<class T>
+    class BoundedQueue {
+    private:
+        struct alignas(kCacheLineSize) Slot {
+            std::atomic<size_t> sequence;
+            T value;
+        };
+
+        size_t mask_;
+        std::unique_ptr<Slot[]> slots_;
+
+        alignas(kCacheLineSize) std::atomic<size_t> push_position_{0};
+        alignas(kCacheLineSize) std::atomic<size_t> pop_position_{0};
+        alignas(kCacheLineSize) std::atomic_bool closed_{false};
+
+        // Waits a little before retrying a full or empty queue: spins first, then yields, then sleeps.
+        static void Backoff(int& round) {
+            if (round < 16) {
+                ++round;
+            } else if (round < 64) {
+                ++round;
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+
+    public:
+        explicit BoundedQueue(size_t capacity = 1024) {
+            assert(capacity >= 1);
+            size_t size = 2;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            mask_ = size - 1;
+            slots_ = std::make_unique<Slot[]>(size);
+            for (size_t index = 0; index < size; ++index) {
+                slots_[index].sequence.store(index, std::memory_order_relaxed);
+            }
+        }
+
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        size_t capacity() const {
+            return mask_ + 1;
+        }
+
+        // Adds a value unless the queue is full. Returns whether it was added.
+        bool TryPush(T&& value) {
+            size_t position = push_position_.load(std::memory_order_relaxed);
+            while (true) {
+                Slot& slot = slots_[position & mask_];
+                size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+                if (difference == 0) {
+                    if (push_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        slot.value = std::move(value);
+                        slot.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = push_position_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Takes the oldest value unless the queue is empty. Returns whether there was one.
+        bool TryPop(T& value) {
+            size_t position = pop_position_.load(std::memory_order_relaxed);
+            while (true) {
+                Slot& slot = slots_[position & mask_];
+                size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+                if (difference == 0) {
+                    if (pop_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        value = std::move(slot.value);
+                        slot.sequence.store(position + mask_ + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = pop_position_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Adds a value, waiting while the queue is full. Returns false, dropping the value, once the queue is closed.
+        bool Push(T&& value) {
+            for (int round = 0; !closed_.load(std::memory_order_acquire); Backoff(round)) {
+                if (TryPush(std::move(value))) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Takes the oldest value, waiting while the queue is empty. Returns false once it is closed and drained.
+        bool Pop(T& value) {
+            for (int round = 0; ; Backoff(round)) {
+                if (TryPop(value)) {
+                    return true;
+                }
+                // Values pushed before Close() are visible once it is seen, so one more try drains them.
+                if (closed_.load(std::memory_order_acquire)) {
+                    return TryPop(value);
+                }
+            }
+        }
+
+        // Ends the stream: waiting and later pushes fail, and pops fail once the values left are taken.
+        void Close() {
+            closed_.store(true, std::memory_order_release);
+        }
+
+        bool closed() const {
+            return closed_.load(std::memory_order_acquire);
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef MINEALGO_MS_RANDOM_H_
+#define MINEALGO_MS_RANDOM_H_
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace ms_algo {
+    // One step of SplitMix64, used to spread seeds over the state of Xoshiro256.
+    constexpr uint64_t SplitMix64(uint64_t& state) {
+        uint64_t result = (state += 0x9e3779b97f4a7c15ULL);
+        result = (result ^ (result >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        result = (result ^ (result >> 27)) * 0x94d049bb133111ebULL;
+        return result ^ (result >> 31);
+    }
+
+    // Derives the `index`-th seed of a stream from `seed`, for attempts or threads that need their own.
+    constexpr uint64_t DeriveSeed(uint64_t seed, uint64_t index) {
+        uint64_t state = seed ^ (index * 0xd1b54a32d192ed03ULL);
+        return SplitMix64(state);
+    }
+
+    // xoshiro256**: a small, fast generator with 256 bits of state. Satisfies UniformRandomBitGenerator.
+    class Xoshiro256 {
+    private:
+        uint64_t state_[4];
+
+        static constexpr uint64_t RotateLeft(uint64_t value, int shift) {
+            return (value << shift) | (value >> (64 - shift));
+        }
+
+    public:
+        using result_type = uint64_t;
+
+        explicit Xoshiro256(uint64_t seed = 0) {
+            Seed(seed);
+        }
+
+        // Resets the generator. The same seed gives the same sequence on every platform.
+        void Seed(uint64_t seed) {
+            for (uint64_t& word: state_) {
+                word = SplitMix64(seed);
+            }
+        }
+
+        static constexpr result_type min() {
+            return 0;
+        }
+
+        static constexpr result_type max() {
+            return std::numeric_limits<uint64_t>::max();
+        }
+
+        result_type operator()() {
+            uint64_t result = RotateLeft(state_[1] * 5, 7) * 9;
+            uint64_t shifted = state_[1] << 17;
+            state_[2] ^= state_[0];
+            state_[3] ^= state_[1];
+            state_[1] ^= state_[2];
+            state_[0] ^= state_[3];
+            state_[2] ^= shifted;
+            state_[3] = RotateLeft(state_[3], 45);
+            return result;
+        }
+
+        // Returns an unbiased integer in [0, bound) by Lemire's multiply-and-reject method,
+        // which rejects with probability below bound / 2^32 instead of dividing every time.
+        uint32_t Below(uint32_t bound) {
+            assert(bound != 0);
+            uint64_t product = (uint64_t)(uint32_t)((*this)() >> 32) * bound;
+            uint32_t low = (uint32_t)product;
+            if (low < bound) {
+                uint32_t threshold = -bound % bound;
+                while (low < threshold) {
+                    product = (uint64_t)(uint32_t)((*this)() >> 32) * bound;
+                    low = (uint32_t)product;
+                }
+            }
+            return product >> 32;
+        }
+
+        // Returns a double in [0, 1) with 53 random bits.
+        double Uniform() {
+            return ((*this)() >> 11) * 0x1.0p-53;
+        }
+
+        // Shuffles a range with Fisher-Yates, so the order only depends on the seed and the range.
+        template<class T>
+        void Shuffle(std::vector<T>& vec) {
+            for (size_t index = vec.size(); index > 1; --index) {
+                std::swap(vec[index - 1], vec[Below((uint32_t)index)]);
+            }
+        }
+
+        // Moves a uniform sample of `count` elements to the front, leaving the rest in any order.
+        template<class T>
+        void SampleToFront(std::vector<T>& vec, size_t count) {
+            assert(count <= vec.size());
+            for (size_t index = 0; index < count; ++index) {
+                std::swap(vec[index], vec[index + Below((uint32_t)(vec.size() - index))]);
+            }
+        }
+    };
+
+    // The generator of the current thread. Each thread starts from its own seed, which differs between runs,
+    // unless SeedThreadRandom() is called.
+    Xoshiro256& ThreadRandom() {
+        static std::atomic<uint64_t> thread_seeds{(uint64_t)std::chrono::system_clock::now().time_since_epoch().count()};
+        static thread_local Xoshiro256 generator(DeriveSeed(thread_seeds.fetch_add(1), 0));
+        return generator;
+    }
+
+    // Draws a nonzero seed from the generator of the current thread. Zero stands for "no seed" in the library.
+    uint64_t NewSeed() {
+        uint64_t seed;
+        do {
+            seed = ThreadRandom()();
+        } while (seed == 0);
+        return seed;
+    }
+
+    // Reseeds the generator of the current thread, to make what it draws reproducible.
+    void SeedThreadRandom(uint64_t seed) {
+        ThreadRandom().Seed(seed);
+    }
+}
+
+#endif
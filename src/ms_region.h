@@ -0,0 +1,183 @@
+#ifndef MINEALGO_MS_REGION_H_
+#define MINEALGO_MS_REGION_H_
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "ms_bitboard.h"
+#include "ms_grid.h"
+#include "ms_instrument.h"
+#include "ms_lib.h"
+
+namespace ms_algo {
+    using std::vector;
+
+    // A sparse equation: (variable, coefficient) pairs sorted by variable, and the right-hand side.
+    // A minesweeper constraint has at most 8 entries, however large its region is.
+    struct SparseRow {
+        vector<std::pair<int, int>> entries;
+        int value = 0;
+    };
+
+    using SparseMatrix = vector<SparseRow>;
+
+    // Returns the coefficient of `variable` in a sparse row.
+    int Coefficient(const SparseRow& row, int variable) {
+        auto it = std::lower_bound(row.entries.begin(), row.entries.end(), std::make_pair(variable, std::numeric_limits<int>::min()));
+        return it != row.entries.end() && it->first == variable ? it->second : 0;
+    }
+
+    using Positions = vector<std::pair<int, int>>;
+
+    // A region of the frontier: its unknown grids, and one constraint per opened grid around them.
+    // Variable `i` of the constraints is grid `first[i]`.
+    using Region = std::pair<Positions, SparseMatrix>;
+
+    // Collects the region connected to (row, column): the opened grids in `known_positions` and the unknown ones in
+    // `unknown_positions`, in depth-first order. Walks with an explicit stack, since a frontier can be as long as the board.
+    void Search(
+        int row,
+        int column,
+        int row_count,
+        int column_count,
+        const Matrix<std::pair<GridState, int>>& states,
+        Matrix<int>& search_states,
+        Positions& known_positions,
+        Positions& unknown_positions
+    ) {
+        // A grid being searched, and the next direction to look at from it.
+        struct Frame {
+            int row;
+            int column;
+            int direction;
+        };
+        vector<Frame> stack;
+
+        auto visit = [&](int row, int column) {
+            if (states[row][column].first == GridState::kOpened) {
+                known_positions.emplace_back(row, column);
+            } else {
+                unknown_positions.emplace_back(row, column);
+            }
+            search_states[row][column] = -1;
+            stack.push_back({row, column, 0});
+        };
+
+        visit(row, column);
+        while (!stack.empty()) {
+            Frame& frame = stack.back();
+            if (frame.direction == 8) {
+                stack.pop_back();
+                continue;
+            }
+            int index = frame.direction++;
+            GridState current_state = states[frame.row][frame.column].first;
+            int next_row = frame.row + kRowOffset[index];
+            int next_column = frame.column + kColumnOffset[index];
+            if (!Inside(next_row, next_column, row_count, column_count)) {
+                continue;
+            }
+            if (search_states[next_row][next_column] > -2) {
+                continue;
+            }
+
+            bool search_next = false;
+            if (current_state == GridState::kOpened && states[next_row][next_column].first == GridState::kUnknown) {
+                search_next = true;
+            }
+            else if (current_state == GridState::kUnknown && search_states[next_row][next_column] == -2) {
+                search_next = true;
+            }
+            if (search_next) {
+                visit(next_row, next_column);
+            }
+        }
+    }
+
+    vector<Region> Divide(int row_count, int column_count, const Matrix<std::pair<GridState, int>>& states) {
+        ScopedStage stage(Stage::kDivide);
+        vector<Region> result;
+        Matrix<int> search_states(row_count + 1, vector<int>(column_count + 1, -3));
+
+        if (kUseBitBoard) {
+            // Kept per thread, so that the planes and the mask are only allocated when a board grows.
+            static thread_local BitBoard bit_board;
+            static thread_local vector<uint64_t> frontier;
+            bit_board.Assign(row_count, column_count, states);
+            bit_board.FrontierMask(frontier);
+            bit_board.ForEach(frontier, [&](int row, int column) {
+                search_states[row][column] = -2;
+            });
+        } else {
+            for (int row = 1; row <= row_count; ++row) {
+                for (int column = 1; column <= column_count; ++column) {
+                    if (states[row][column].first != GridState::kOpened) {
+                        continue;
+                    }
+                    for (int index = 0; index < 8; ++index) {
+                        int next_row = row + kRowOffset[index];
+                        int next_column = column + kColumnOffset[index];
+                        if (Inside(next_row, next_column, row_count, column_count) && states[next_row][next_column].first == GridState::kUnknown) {
+                            search_states[row][column] = -2;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        for (int row = 1; row <= row_count; ++row) {
+            for (int column = 1; column <= column_count; ++column) {
+                if (search_states[row][column] != -2) {
+                    continue;
+                }
+
+                Positions known_positions, unknown_positions;
+                Search(row, column, row_count, column_count, states, search_states, known_positions, unknown_positions);
+                for (int index = 0; index < (int)unknown_positions.size(); ++index) {
+                    auto [p_row, p_column] = unknown_positions[index];
+                    search_states[p_row][p_column] = index;
+                }
+
+                SparseMatrix gauss_matrix;
+                for (auto [p_row, p_column]: known_positions) {
+                    SparseRow equation;
+
+                    int mine_count = states[p_row][p_column].second;
+                    for (int index = 0; index < 8; ++index) {
+                        int next_row = p_row + kRowOffset[index];
+                        int next_column = p_column + kColumnOffset[index];
+
+                        if (Inside(next_row, next_column, row_count, column_count)) {
+                            switch (states[next_row][next_column].first)
+                            {
+                            case GridState::kFlaged:
+                                --mine_count;
+                                break;
+                            case GridState::kUnknown:
+                                equation.entries.emplace_back(search_states[next_row][next_column], 1);
+                                break;
+                            default:
+                                break;
+                            }
+                        }
+                    }
+                    std::sort(equation.entries.begin(), equation.entries.end());
+                    equation.value = mine_count;
+                    gauss_matrix.emplace_back(std::move(equation));
+                }
+                result.emplace_back(unknown_positions, gauss_matrix);
+            }
+        }
+        if (InstrumentationEnabled()) {
+            for (const Region& region: result) {
+                RecordDistribution(Distribution::kRegionSize, region.first.size());
+            }
+        }
+        return result;
+    }
+}
+
+#endif
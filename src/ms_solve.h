@@ -1,386 +1,1699 @@
-#ifndef MINEALGO_MS_SOLVE_H_
-#define MINEALGO_MS_SOLVE_H_
-
-#include <algorithm>
-#include <atomic>
-#include <cassert>
-#include <future>
-#include <iomanip>
-#include <iostream>
-#include <utility>
-#include <vector>
-
-#include "ms_board.h"
-#include "ms_grid.h"
-#include "ms_lib.h"
-#include "ms_timer.h"
-
-namespace ms_algo {
-    vector<std::pair<int, int>> GaussianElimination(Matrix<double>& matrix) {
-        if (kPrintDebugInfo) {
-            std::clog << "GaussianElimination:" << std::endl;
-            std::clog << "Before Gaussian:" << std::endl;
-            for (const auto& row: matrix) {
-                for (auto number: row) {
-                    std::clog << std::fixed << std::setprecision(0) << number << ' ';
-                }
-                std::clog << std::endl;
-            }
-        }
-
-        int unfree_variable_count = 0;
-        for (size_t current = 0; current < matrix[0].size(); ++current) {
-            int max_row = unfree_variable_count;
-            for (size_t row = max_row + 1; row < matrix.size(); ++row) {
-                if (Greater(std::abs(matrix[row][current]), std::abs(matrix[max_row][current]))) {
-                    max_row = row;
-                }
-            }
-
-            if (IsZero(matrix[max_row][current])) {
-                continue;
-            }
-
-            if (unfree_variable_count != max_row) {
-                std::swap(matrix[unfree_variable_count], matrix[max_row]);
-            }
-
-            for (int row = 0; row < (int)matrix.size(); ++row) {
-                if (row != unfree_variable_count && NotZero(matrix[row][current])) {
-                    matrix[row] -= matrix[unfree_variable_count] * (matrix[row][current] / matrix[unfree_variable_count][current]);
-                }
-            }
-            matrix[unfree_variable_count] /= matrix[unfree_variable_count][current];
-
-            ++unfree_variable_count;
-            if (unfree_variable_count == (int)matrix.size()) {
-                break;
-            }
-        }
-        matrix.resize(unfree_variable_count);
-
-        if (kPrintDebugInfo) {
-            std::clog << "After Gaussian:" << std::endl;
-            for (const auto& row: matrix) {
-                for (auto number: row) {
-                    std::clog << std::fixed << std::setprecision(0) << number << ' ';
-                }
-                std::clog << std::endl;
-            }
-        }
-
-        vector<std::pair<int, int>> result;
-        for (const auto& row: matrix) {
-            int not_zero_position = -1;
-            for (size_t column = 0; column + 1 < row.size(); ++column) {
-                if (NotZero(row[column])) {
-                    if (not_zero_position == -1) {
-                        not_zero_position = column;
-                    } else {
-                        not_zero_position = -1;
-                        break;
-                    }
-                }
-            }
-            if (not_zero_position != -1) {
-                if (IsZero(row.back())) {
-                    result.emplace_back(not_zero_position, 0);
-                } else if (Equal(row.back(), 1.0)) {
-                    result.emplace_back(not_zero_position, 1);
-                } else {
-                    std::cerr << "Gaussian Elimination Error." << std::endl;
-                    assert(false);
-                }
-            }
-        }
-        return result;
-    }
-
-    std::pair<int64_t, vector<int64_t>> EnumerateMine(const Matrix<double>& matrix, Timer& timer) {
-        int variable_count = (*matrix.begin()).size() - 1;
-        int unfree_variable_count = matrix.size();
-        int free_variable_count = variable_count - unfree_variable_count;
-
-        vector<int> free_variable_positions;
-        vector<int> unfree_variable_positions;
-        free_variable_positions.reserve(free_variable_count);
-        unfree_variable_positions.reserve(unfree_variable_count);
-        for (const auto& row: matrix) {
-            for (size_t column = 0; column + 1 < row.size(); ++column) {
-                if (NotZero(row[column])) {
-                    unfree_variable_positions.push_back(column);
-                    break;
-                }
-            }
-        }
-        for (int index = 0; index < variable_count; ++index) {
-            if (std::find(unfree_variable_positions.begin(), unfree_variable_positions.end(), index) == unfree_variable_positions.end()) {
-                free_variable_positions.push_back(index);
-            }
-        }
-
-        int64_t legal_count = 0;
-        vector<int64_t> count(variable_count, 0);
-        for (int64_t situation = (1 << free_variable_count) - 1; situation >= 0; --situation) {
-            if (timer.TimeIsUp()) {
-                if (kPrintDebugInfo) {
-                    std::cerr << "EnumerateMine Timeout!" << std::endl;
-                }
-                return {};
-            }
-            vector<double> unfree_variables;
-            unfree_variables.reserve(unfree_variable_count);
-            bool illegal = false;
-            for (int unfree_variable_index = 0; unfree_variable_index < unfree_variable_count; ++unfree_variable_index) {
-                double unfree_variable_value = matrix[unfree_variable_index].back();
-                for (int index = 0; index < free_variable_count; ++index) {
-                    unfree_variable_value -= (situation >> index & 1) * matrix[unfree_variable_index][free_variable_positions[index]];
-                }
-                if (!Equal(unfree_variable_value, 0.0) && !Equal(unfree_variable_value, 1.0)) {
-                    illegal = true;
-                    break;
-                }
-                unfree_variables.push_back(unfree_variable_value);
-            }
-            if (illegal) {
-                continue;
-            }
-            ++legal_count;
-            for (int index = 0; index < free_variable_count; ++index) {
-                if ((situation >> index & 1)) {
-                    ++count[free_variable_positions[index]];
-                }
-            }
-            for (int index = 0; index < unfree_variable_count; ++index) {
-                if (Equal(unfree_variables[index], 1.0)) {
-                    ++count[unfree_variable_positions[index]];
-                }
-            }
-        }
-        return {legal_count, count};
-    }
-
-    using Positions = vector<std::pair<int, int>>;
-    using Region = std::pair<Positions, Matrix<double>>;
-
-    void Search(
-        int row,
-        int column,
-        int row_count,
-        int column_count,
-        const Matrix<std::pair<GridState, int>>& states,
-        Matrix<int>& search_states,
-        Positions& known_positions,
-        Positions& unknown_positions
-    ) {
-        GridState current_state = states[row][column].first;
-        if (current_state == GridState::kOpened) {
-            known_positions.emplace_back(row, column);
-        } else {
-            unknown_positions.emplace_back(row, column);
-        }
-        search_states[row][column] = -1;
-
-        for (int index = 0; index < 8; ++index) {
-            int next_row = row + kRowOffset[index];
-            int next_column = column + kColumnOffset[index];
-            if (!Inside(next_row, next_column, row_count, column_count)) {
-                continue;
-            }
-            if (search_states[next_row][next_column] > -2) {
-                continue;
-            }
-
-            bool search_next = false;
-            if (current_state == GridState::kOpened && states[next_row][next_column].first == GridState::kUnknown) {
-                search_next = true;
-            }
-            else if (current_state == GridState::kUnknown && search_states[next_row][next_column] == -2) {
-                search_next = true;
-            }
-            if (search_next) {
-                Search(next_row, next_column, row_count, column_count, states, search_states, known_positions, unknown_positions);
-            }
-        }
-    }
-
-    vector<Region> Divide(int row_count, int column_count, const Matrix<std::pair<GridState, int>>& states) {
-        vector<Region> result;
-        Matrix<int> search_states(row_count + 1, vector<int>(column_count + 1, -3));
-
-        for (int row = 1; row <= row_count; ++row) {
-            for (int column = 1; column <= column_count; ++column) {
-                if (states[row][column].first != GridState::kOpened) {
-                    continue;
-                }
-
-                bool unsolved = false;
-                for (int index = 0; index < 8; ++index) {
-                    int next_row = row + kRowOffset[index];
-                    int next_column = column + kColumnOffset[index];
-                    if (Inside(next_row, next_column, row_count, column_count)) {
-                        if (states[next_row][next_column].first == GridState::kUnknown) {
-                            unsolved = true;
-                            break;
-                        }
-                    }
-                }
-                if (unsolved) {
-                    search_states[row][column] = -2;
-                }
-            }
-        }
-
-        for (int row = 1; row <= row_count; ++row) {
-            for (int column = 1; column <= column_count; ++column) {
-                if (search_states[row][column] != -2) {
-                    continue;
-                }
-
-                Positions known_positions, unknown_positions;
-                Search(row, column, row_count, column_count, states, search_states, known_positions, unknown_positions);
-                ShuffleVector(unknown_positions);
-                for (int index = 0; index < (int)unknown_positions.size(); ++index) {
-                    auto [p_row, p_column] = unknown_positions[index];
-                    search_states[p_row][p_column] = index;
-                }
-
-                Matrix<double> gauss_matrix;
-                for (auto [p_row, p_column]: known_positions) {
-                    vector<double> equation(unknown_positions.size() + 1, 0.0);
-
-                    int mine_count = states[p_row][p_column].second;
-                    for (int index = 0; index < 8; ++index) {
-                        int next_row = p_row + kRowOffset[index];
-                        int next_column = p_column + kColumnOffset[index];
-
-                        if (Inside(next_row, next_column, row_count, column_count)) {
-                            switch (states[next_row][next_column].first)
-                            {
-                            case GridState::kFlaged:
-                                --mine_count;
-                                break;
-                            case GridState::kUnknown:
-                                equation[search_states[next_row][next_column]] = 1;
-                                break;
-                            default:
-                                break;
-                            }
-                        }
-                    }
-                    *equation.rbegin() = mine_count;
-                    gauss_matrix.emplace_back(equation);
-                }
-                result.emplace_back(unknown_positions, gauss_matrix);
-            }
-        }
-        return result;
-    }
-
-    bool SolveOneStep(int row_count, int column_count, Matrix<std::pair<GridState, int>>& states, Timer& timer) {
-        if (kPrintDebugInfo) {
-            std::clog << "\nSolveOneStep" << std::endl;
-        }
-
-        assert((int)states.size() == row_count + 1);
-        for (int row = 1; row <= row_count; ++row) {
-            assert((int)states[row].size() == column_count + 1);
-        }
-        vector<Region> regions = Divide(row_count, column_count, states);
-        ShuffleVector(regions);
-
-        if (kPrintDebugInfo) {
-            std::clog << "regions: " << regions.size() << 'x' << std::endl;
-
-            for (const auto& region: regions) {
-                std::clog << "region:\nPositions:";
-
-                for (auto [row, column]: region.first) {
-                    std::clog << " (" << row << ", " << column << ')';
-                }
-
-                std::clog << std::endl << "Matrix: " << region.second.size() << " x " << region.second[0].size() << std::endl;
-                for (const auto& row: region.second) {
-                    for (const auto& number: row) {
-                        std::clog << (int)number << ' ';
-                    }
-                    std::clog << std::endl;
-                }
-            }
-        }
-
-        bool result = false;
-        for (auto& region: regions) {
-            if (timer.TimeIsUp()) {
-                if (kPrintDebugInfo) {
-                    std::clog << "SolveOneStep Timeout!" << std::endl;
-                }
-                break;
-            }
-            vector<std::pair<int, int>> solved = GaussianElimination(region.second);
-            if (!solved.empty()) {
-                for (auto [index, type]: solved) {
-                    auto [row, column] = region.first[index];
-                    states[row][column].first = type ? GridState::kFlaged : GridState::kOpened;
-                }
-                result = true;
-                continue;
-            }
-            auto [legal_count, count] = EnumerateMine(region.second, timer);
-            if (!legal_count) {
-                continue;
-            }
-            for (size_t index = 0; index < count.size(); ++index) {
-                auto [row, column] = region.first[index];
-                if (count[index] == 0) {
-                    states[row][column].first = GridState::kOpened;
-                } else if (count[index] == legal_count) {
-                    states[row][column].first = GridState::kFlaged;
-                } else {
-                    continue;
-                }
-                result = true;
-            }
-        }
-        return result;
-    }
-
-    bool Solvable(Board board, Timer& timer) {
-        if (kPrintDebugInfo) {
-            std::clog << "\nSolvable?" << std::endl;
-            board.Print();
-            board.PrintAll();
-            std::clog << std::endl;
-        }
-
-        while (!timer.TimeIsUp()) {
-            if (board.Solved()) {
-                if (kPrintDebugInfo) {
-                    std::clog << "Solved!" << std::endl;
-                }
-                return true;
-            }
-            Matrix<std::pair<GridState, int>> situation(board.GetSituation());
-
-            if (kPrintDebugInfo) {
-                board.Print();
-            }
-            bool successed = SolveOneStep(board.row_count(), board.column_count(), situation, timer);
-            if (!successed) {
-                return false;
-            }
-            board.SetSituation(situation);
-        }
-        if (kPrintDebugInfo) {
-            std::clog << "Solvable Timeout!" << std::endl;
-        }
-        return false;
-    }
-
-    bool Solvable(Board board, int time_limit_milliseconds = 1000) {
-        Timer timer(time_limit_milliseconds);
-        return Solvable(board, timer);
-    }
-}
-
+#ifndef MINEALGO_MS_SOLVE_H_
+#define MINEALGO_MS_SOLVE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "ms_bitboard.h"
+#include "ms_board.h"
+#include "ms_cache.h"
+#include "ms_count.h"
+#include "ms_grid.h"
+#include "ms_instrument.h"
+#include "ms_lib.h"
+#include "ms_pattern.h"
+#include "ms_probability.h"
+#include "ms_region.h"
+#include "ms_thread_pool.h"
+#include "ms_timer.h"
+
+namespace ms_algo {
+    // Replaces `row` with `multiplier * row - pivot_multiplier * pivot_row`, then divides it by the gcd of its entries.
+    // `pivot_bound` is the largest absolute value in `pivot_row`.
+    // Returns false and leaves `row` unchanged if an entry would not fit in an int.
+    bool CombineRows(vector<int>& row, int multiplier, const vector<int>& pivot_row, int pivot_multiplier, int pivot_bound) {
+        int64_t bound = (int64_t)MaxAbs(row.data(), row.size()) * std::abs(multiplier) + (int64_t)pivot_bound * std::abs(pivot_multiplier);
+        if (bound > std::numeric_limits<int>::max()) {
+            return false;
+        }
+        Combine(row.data(), multiplier, pivot_row.data(), pivot_multiplier, row.size());
+        int divisor = RangeGcd(row.data(), row.size());
+        if (divisor > 1) {
+            DivideExact(row.data(), divisor, row.size());
+        }
+        return true;
+    }
+
+    // Reorders rows so that row `index` becomes `order[index]` of the old matrix, following permutation cycles.
+    template<class Row>
+    void PermuteRows(vector<Row>& matrix, vector<int>& order) {
+        for (int index = 0; index < (int)order.size(); ++index) {
+            int current = index;
+            while (order[current] != index) {
+                int next = order[current];
+                std::swap(matrix[current], matrix[next]);
+                order[current] = current;
+                current = next;
+            }
+            order[current] = current;
+        }
+    }
+
+    /**
+        @brief Reduces an integer system of equations into reduced row echelon form without fractions.
+        @param matrix Each row is `a_1 x_1 + ... + a_n x_n = b` stored as `a_1 ... a_n b`. It is replaced by the
+            reduced system: one row per pivot, with a positive pivot coefficient and zeros in the other pivot columns.
+        @param solved Set to the variables forced by a single-variable row, as (variable, value).
+        @return False if the system has no solution: a row reduces to `0 = b` with `b` nonzero, or forces a
+            variable to something other than 0 or 1. `solved` is then empty.
+
+        Rows are combined fraction-free and divided by the gcd of their entries, so coefficients stay small.
+        If an entry would overflow, elimination stops and only the finished pivot rows are kept; that system
+        is implied by the original one, so anything it forces is still forced.
+    */
+    bool GaussianElimination(Matrix<int>& matrix, vector<std::pair<int, int>>& solved) {
+        ScopedStage stage(Stage::kElimination);
+        solved.clear();
+        if (kPrintDebugInfo) {
+            std::clog << "GaussianElimination:" << std::endl;
+            std::clog << "Before Gaussian:" << std::endl;
+            for (const auto& row: matrix) {
+                for (auto number: row) {
+                    std::clog << number << ' ';
+                }
+                std::clog << std::endl;
+            }
+        }
+
+        // Rows are pivoted through `order` instead of being moved.
+        vector<int> order(matrix.size());
+        std::iota(order.begin(), order.end(), 0);
+        int unfree_variable_count = 0;
+        bool overflow = false;
+        for (size_t current = 0; current + 1 < matrix[0].size() && !overflow; ++current) {
+            // Picks the smallest nonzero pivot to keep the combined rows small.
+            int pivot_index = -1;
+            for (int index = unfree_variable_count; index < (int)order.size(); ++index) {
+                int value = std::abs(matrix[order[index]][current]);
+                if (value != 0 && (pivot_index == -1 || value < std::abs(matrix[order[pivot_index]][current]))) {
+                    pivot_index = index;
+                }
+            }
+            if (pivot_index == -1) {
+                continue;
+            }
+
+            std::swap(order[unfree_variable_count], order[pivot_index]);
+            vector<int>& pivot = matrix[order[unfree_variable_count]];
+            if (pivot[current] < 0) {
+                Scale(pivot.data(), -1, pivot.size());
+            }
+            int pivot_bound = MaxAbs(pivot.data(), pivot.size());
+
+            for (int index = 0; index < (int)order.size(); ++index) {
+                vector<int>& row = matrix[order[index]];
+                if (index != unfree_variable_count && row[current] != 0) {
+                    int divisor = std::gcd(pivot[current], row[current]);
+                    if (!CombineRows(row, pivot[current] / divisor, pivot, row[current] / divisor, pivot_bound)) {
+                        overflow = true;
+                        break;
+                    }
+                }
+            }
+            if (overflow) {
+                break;
+            }
+
+            ++unfree_variable_count;
+            if (unfree_variable_count == (int)matrix.size()) {
+                break;
+            }
+        }
+        PermuteRows(matrix, order);
+        for (size_t index = unfree_variable_count; index < matrix.size(); ++index) {
+            const vector<int>& row = matrix[index];
+            if (row.back() != 0 && std::all_of(row.begin(), row.end() - 1, [](int value) { return value == 0; })) {
+                return false;
+            }
+        }
+        matrix.resize(unfree_variable_count);
+
+        if (overflow && kPrintDebugInfo) {
+            std::clog << "GaussianElimination Overflow!" << std::endl;
+        }
+
+        if (kPrintDebugInfo) {
+            std::clog << "After Gaussian:" << std::endl;
+            for (const auto& row: matrix) {
+                for (auto number: row) {
+                    std::clog << number << ' ';
+                }
+                std::clog << std::endl;
+            }
+        }
+
+        for (const auto& row: matrix) {
+            int not_zero_position = -1;
+            for (size_t column = 0; column + 1 < row.size(); ++column) {
+                if (row[column] != 0) {
+                    if (not_zero_position == -1) {
+                        not_zero_position = column;
+                    } else {
+                        not_zero_position = -1;
+                        break;
+                    }
+                }
+            }
+            if (not_zero_position != -1) {
+                if (row.back() == 0) {
+                    solved.emplace_back(not_zero_position, 0);
+                } else if (row.back() == row[not_zero_position]) {
+                    solved.emplace_back(not_zero_position, 1);
+                } else {
+                    solved.clear();
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Counts the solutions of a system reduced by GaussianElimination(), and how many of them each variable is mine in.
+    std::pair<int64_t, vector<int64_t>> EnumerateMine(const Matrix<int>& matrix, int variable_count, Timer& timer) {
+        int unfree_variable_count = matrix.size();
+        int free_variable_count = variable_count - unfree_variable_count;
+
+        vector<int> free_variable_positions;
+        vector<int> unfree_variable_positions;
+        free_variable_positions.reserve(free_variable_count);
+        unfree_variable_positions.reserve(unfree_variable_count);
+        for (const auto& row: matrix) {
+            for (size_t column = 0; column + 1 < row.size(); ++column) {
+                if (row[column] != 0) {
+                    unfree_variable_positions.push_back(column);
+                    break;
+                }
+            }
+        }
+        for (int index = 0; index < variable_count; ++index) {
+            if (std::find(unfree_variable_positions.begin(), unfree_variable_positions.end(), index) == unfree_variable_positions.end()) {
+                free_variable_positions.push_back(index);
+            }
+        }
+
+        int64_t legal_count = 0;
+        vector<int64_t> count(variable_count, 0);
+        vector<int> unfree_variables(unfree_variable_count);
+        for (int64_t situation = (int64_t(1) << free_variable_count) - 1; situation >= 0; --situation) {
+            if (timer.TimeIsUp()) {
+                if (kPrintDebugInfo) {
+                    std::cerr << "EnumerateMine Timeout!" << std::endl;
+                }
+                return {};
+            }
+            bool illegal = false;
+            for (int unfree_variable_index = 0; unfree_variable_index < unfree_variable_count; ++unfree_variable_index) {
+                const vector<int>& row = matrix[unfree_variable_index];
+                int pivot = row[unfree_variable_positions[unfree_variable_index]];
+                int unfree_variable_value = row.back();
+                for (int index = 0; index < free_variable_count; ++index) {
+                    unfree_variable_value -= (situation >> index & 1) * row[free_variable_positions[index]];
+                }
+                // The pivot variable is `value / pivot`, which must be 0 or 1.
+                if (unfree_variable_value != 0 && unfree_variable_value != pivot) {
+                    illegal = true;
+                    break;
+                }
+                unfree_variables[unfree_variable_index] = unfree_variable_value != 0;
+            }
+            if (illegal) {
+                continue;
+            }
+            ++legal_count;
+            for (int index = 0; index < free_variable_count; ++index) {
+                if ((situation >> index & 1)) {
+                    ++count[free_variable_positions[index]];
+                }
+            }
+            for (int index = 0; index < unfree_variable_count; ++index) {
+                if (unfree_variables[index]) {
+                    ++count[unfree_variable_positions[index]];
+                }
+            }
+        }
+        return {legal_count, count};
+    }
+
+    // Replaces `row` with `multiplier * row - pivot_multiplier * pivot_row` by merging the entries into `buffer`,
+    // then divides it by the gcd of its entries.
+    // Returns false and leaves `row` unchanged if an entry would not fit in an int.
+    bool CombineRows(SparseRow& row, int multiplier, const SparseRow& pivot_row, int pivot_multiplier, vector<std::pair<int, int>>& buffer) {
+        const int64_t kLimit = std::numeric_limits<int>::max();
+        buffer.clear();
+        auto lhs = row.entries.cbegin(), rhs = pivot_row.entries.cbegin();
+        while (lhs != row.entries.cend() || rhs != pivot_row.entries.cend()) {
+            int variable;
+            int64_t number = 0;
+            if (rhs == pivot_row.entries.cend() || (lhs != row.entries.cend() && lhs->first < rhs->first)) {
+                variable = lhs->first;
+                number = (int64_t)multiplier * (lhs++)->second;
+            } else if (lhs == row.entries.cend() || rhs->first < lhs->first) {
+                variable = rhs->first;
+                number = -(int64_t)pivot_multiplier * (rhs++)->second;
+            } else {
+                variable = lhs->first;
+                number = (int64_t)multiplier * (lhs++)->second - (int64_t)pivot_multiplier * (rhs++)->second;
+            }
+            if (std::abs(number) > kLimit) {
+                return false;
+            }
+            if (number != 0) {
+                buffer.emplace_back(variable, number);
+            }
+        }
+        int64_t value = (int64_t)multiplier * row.value - (int64_t)pivot_multiplier * pivot_row.value;
+        if (std::abs(value) > kLimit) {
+            return false;
+        }
+
+        row.entries.swap(buffer);
+        row.value = value;
+        int divisor = row.value;
+        for (size_t index = 0; index < row.entries.size() && divisor != 1; ++index) {
+            divisor = std::gcd(divisor, row.entries[index].second);
+        }
+        if (divisor > 1) {
+            for (auto& entry: row.entries) {
+                entry.second /= divisor;
+            }
+            row.value /= divisor;
+        }
+        return true;
+    }
+
+    /**
+        @brief Same as GaussianElimination() on a dense matrix, for a sparse system of `variable_count` variables.
+
+        Columns are eliminated in variable order, which follows the frontier, and each pivot is taken from the
+        shortest row containing the column. Both keep the fill-in low, so rows stay short during elimination.
+        Each reduced row starts with its pivot.
+    */
+    bool GaussianElimination(SparseMatrix& matrix, int variable_count, vector<std::pair<int, int>>& solved) {
+        ScopedStage stage(Stage::kElimination);
+        solved.clear();
+        // Per-thread buffers, which keep their memory between regions.
+        static thread_local vector<int> order;
+        static thread_local vector<std::pair<int, int>> buffer;
+        order.resize(matrix.size());
+        std::iota(order.begin(), order.end(), 0);
+        int unfree_variable_count = 0;
+        bool overflow = false;
+        for (int current = 0; current < variable_count && unfree_variable_count < (int)matrix.size(); ++current) {
+            int pivot_index = -1;
+            size_t pivot_size = 0;
+            for (int index = unfree_variable_count; index < (int)order.size(); ++index) {
+                const SparseRow& row = matrix[order[index]];
+                if (Coefficient(row, current) != 0 && (pivot_index == -1 || row.entries.size() < pivot_size)) {
+                    pivot_index = index;
+                    pivot_size = row.entries.size();
+                }
+            }
+            if (pivot_index == -1) {
+                continue;
+            }
+
+            std::swap(order[unfree_variable_count], order[pivot_index]);
+            SparseRow& pivot = matrix[order[unfree_variable_count]];
+            int pivot_coefficient = Coefficient(pivot, current);
+            if (pivot_coefficient < 0) {
+                for (auto& entry: pivot.entries) {
+                    entry.second = -entry.second;
+                }
+                pivot.value = -pivot.value;
+                pivot_coefficient = -pivot_coefficient;
+            }
+
+            for (int index = 0; index < (int)order.size(); ++index) {
+                SparseRow& row = matrix[order[index]];
+                int coefficient = index == unfree_variable_count ? 0 : Coefficient(row, current);
+                if (coefficient != 0) {
+                    int divisor = std::gcd(pivot_coefficient, coefficient);
+                    if (!CombineRows(row, pivot_coefficient / divisor, pivot, coefficient / divisor, buffer)) {
+                        overflow = true;
+                        break;
+                    }
+                }
+            }
+            if (overflow) {
+                if (kPrintDebugInfo) {
+                    std::clog << "GaussianElimination Overflow!" << std::endl;
+                }
+                break;
+            }
+            ++unfree_variable_count;
+        }
+        PermuteRows(matrix, order);
+        for (size_t index = unfree_variable_count; index < matrix.size(); ++index) {
+            if (matrix[index].entries.empty() && matrix[index].value != 0) {
+                return false;
+            }
+        }
+        matrix.resize(unfree_variable_count);
+
+        for (const auto& row: matrix) {
+            if (row.entries.size() != 1) {
+                continue;
+            }
+            if (row.value == 0) {
+                solved.emplace_back(row.entries[0].first, 0);
+            } else if (row.value == row.entries[0].second) {
+                solved.emplace_back(row.entries[0].first, 1);
+            } else {
+                solved.clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The number of enumeration steps between two deadline checks.
+    const int kEnumerateCheckInterval = 1 << 12;
+
+    // Bit patterns of the first 6 free variables over the 64 lanes of a word: lane `l` assigns bit `k` of `l` to variable `k`.
+    const uint64_t kLanePatterns[6] = {
+        0xAAAAAAAAAAAAAAAAull,
+        0xCCCCCCCCCCCCCCCCull,
+        0xF0F0F0F0F0F0F0F0ull,
+        0xFF00FF00FF00FF00ull,
+        0xFFFF0000FFFF0000ull,
+        0xFFFFFFFF00000000ull,
+    };
+
+    /**
+        @brief Same as EnumerateMine() on a dense matrix, for a sparse system reduced by GaussianElimination().
+
+        The first 6 free variables are bit-sliced: the 64 assignments of them are evaluated at once, one per bit of
+        a word. The remaining free variables are walked in Gray-code order, so each step flips one variable and only
+        updates the rows containing it.
+        Returns the number of solutions, and sets `count` to the number of them in which each variable is mine. Both are
+        empty on timeout, or if there are more than 62 free variables. `count` keeps its storage between calls.
+    */
+    int64_t EnumerateMine(const SparseMatrix& matrix, int variable_count, Timer& timer, vector<int64_t>& count) {
+        count.clear();
+        int unfree_variable_count = matrix.size();
+        int free_variable_count = variable_count - unfree_variable_count;
+        if (free_variable_count > 62) {
+            return 0;
+        }
+        int sliced_count = std::min(free_variable_count, 6);
+        int stepped_count = free_variable_count - sliced_count;
+        uint64_t lane_mask = sliced_count == 6 ? ~uint64_t(0) : (uint64_t(1) << (1 << sliced_count)) - 1;
+
+        // Per-thread buffers, which keep their memory between regions. The vectors of vectors only grow,
+        // and only their first unfree_variable_count and stepped_count entries are used.
+        static thread_local vector<int> free_index, free_variable_positions;
+        static thread_local vector<vector<std::pair<int64_t, uint64_t>>> lane_values;
+        static thread_local vector<vector<std::pair<int, int>>> stepped_rows;
+        static thread_local vector<int64_t> residuals;
+        static thread_local vector<uint64_t> valid_lanes, mine_lanes;
+        static thread_local vector<uint8_t> stepped_values;
+
+        // Maps each free variable to its slot: [0, sliced_count) are sliced, the rest are stepped.
+        free_index.assign(variable_count, 0);
+        for (const auto& row: matrix) {
+            free_index[row.entries[0].first] = -1;
+        }
+        free_variable_positions.clear();
+        for (int index = 0; index < variable_count; ++index) {
+            if (free_index[index] != -1) {
+                free_index[index] = free_variable_positions.size();
+                free_variable_positions.push_back(index);
+            }
+        }
+
+        // For each row: the lanes grouped by the value the sliced variables contribute, sorted by value.
+        if ((int)lane_values.size() < unfree_variable_count) {
+            lane_values.resize(unfree_variable_count);
+        }
+        // For each stepped variable: the rows containing it and its coefficient there.
+        if ((int)stepped_rows.size() < stepped_count) {
+            stepped_rows.resize(stepped_count);
+        }
+        for (int slot = 0; slot < stepped_count; ++slot) {
+            stepped_rows[slot].clear();
+        }
+        residuals.assign(unfree_variable_count, 0);
+        for (int row_index = 0; row_index < unfree_variable_count; ++row_index) {
+            const SparseRow& row = matrix[row_index];
+            residuals[row_index] = row.value;
+            int64_t lane_sums[64] = {};
+            for (size_t index = 1; index < row.entries.size(); ++index) {
+                auto [variable, coefficient] = row.entries[index];
+                int slot = free_index[variable];
+                if (slot < sliced_count) {
+                    for (int lane = 0; lane < 64; ++lane) {
+                        lane_sums[lane] += (lane >> slot & 1) * coefficient;
+                    }
+                } else {
+                    stepped_rows[slot - sliced_count].emplace_back(row_index, coefficient);
+                }
+            }
+            auto& values = lane_values[row_index];
+            values.clear();
+            for (int lane = 0; lane < 64; ++lane) {
+                values.emplace_back(lane_sums[lane], uint64_t(1) << lane);
+            }
+            std::sort(values.begin(), values.end());
+            size_t size = 0;
+            for (size_t index = 0; index < values.size(); ++index) {
+                if (size != 0 && values[size - 1].first == values[index].first) {
+                    values[size - 1].second |= values[index].second;
+                } else {
+                    values[size++] = values[index];
+                }
+            }
+            values.resize(size);
+        }
+
+        auto lanes_with_value = [&](int row_index, int64_t value) -> uint64_t {
+            const auto& values = lane_values[row_index];
+            auto it = std::lower_bound(values.begin(), values.end(), std::make_pair(value, uint64_t(0)));
+            return it != values.end() && it->first == value ? it->second : 0;
+        };
+
+        // The lanes where each row's pivot is 0 or 1, and where it is 1; rows without valid lanes are dead.
+        valid_lanes.assign(unfree_variable_count, 0);
+        mine_lanes.assign(unfree_variable_count, 0);
+        int dead_count = 0;
+        auto update_row = [&](int row_index) {
+            dead_count -= valid_lanes[row_index] == 0;
+            uint64_t zero = lanes_with_value(row_index, residuals[row_index]);
+            uint64_t one = lanes_with_value(row_index, residuals[row_index] - matrix[row_index].entries[0].second);
+            mine_lanes[row_index] = one;
+            valid_lanes[row_index] = (zero | one) & lane_mask;
+            dead_count += valid_lanes[row_index] == 0;
+        };
+        for (int row_index = 0; row_index < unfree_variable_count; ++row_index) {
+            valid_lanes[row_index] = 1;
+            update_row(row_index);
+        }
+
+        uint64_t legal_count = 0;
+        count.assign(variable_count, 0);
+        stepped_values.assign(stepped_count, 0);
+        uint64_t step_count = uint64_t(1) << stepped_count;
+        for (uint64_t step = 0; step < step_count; ++step) {
+            if (step != 0) {
+                if (step % kEnumerateCheckInterval == 0 && timer.TimeIsUp()) {
+                    if (kPrintDebugInfo) {
+                        std::cerr << "EnumerateMine Timeout!" << std::endl;
+                    }
+                    count.clear();
+                    return 0;
+                }
+                int slot = CountTrailingZeros(step);
+                stepped_values[slot] ^= 1;
+                int sign = stepped_values[slot] ? 1 : -1;
+                for (auto [row_index, coefficient]: stepped_rows[slot]) {
+                    residuals[row_index] -= sign * coefficient;
+                    update_row(row_index);
+                }
+            }
+            if (dead_count != 0) {
+                continue;
+            }
+
+            uint64_t valid = lane_mask;
+            for (uint64_t lanes: valid_lanes) {
+                valid &= lanes;
+            }
+            if (valid == 0) {
+                continue;
+            }
+            uint64_t valid_count = PopCount(valid);
+            legal_count += valid_count;
+            for (int slot = 0; slot < sliced_count; ++slot) {
+                count[free_variable_positions[slot]] += PopCount(valid & kLanePatterns[slot]);
+            }
+            for (int slot = 0; slot < stepped_count; ++slot) {
+                if (stepped_values[slot]) {
+                    count[free_variable_positions[sliced_count + slot]] += valid_count;
+                }
+            }
+            for (int row_index = 0; row_index < unfree_variable_count; ++row_index) {
+                count[matrix[row_index].entries[0].first] += PopCount(valid & mine_lanes[row_index]);
+            }
+        }
+        return legal_count;
+    }
+
+    // Same as above, returning the number of solutions and the counts.
+    std::pair<int64_t, vector<int64_t>> EnumerateMine(const SparseMatrix& matrix, int variable_count, Timer& timer) {
+        std::pair<int64_t, vector<int64_t>> result;
+        result.first = EnumerateMine(matrix, variable_count, timer, result.second);
+        return result;
+    }
+
+    // Counts the solutions of a region's constraints by backtracking with propagation.
+    class MineBacktracker {
+    private:
+        const SparseMatrix& constraints_;
+
+        int variable_count_;
+
+        // Whether to stop once every variable has been seen both as mine and as safe.
+        bool early_exit_;
+
+        Timer& timer_;
+
+        // For each variable: the constraints containing it.
+        vector<vector<int>> variable_constraints_;
+
+        // For each variable: -1 if unassigned, otherwise 0 or 1.
+        vector<int> values_;
+
+        // For each constraint: the mines still needed, and the variables still unassigned.
+        vector<int> remaining_;
+        vector<int> unassigned_;
+
+        // Assigned variables in order, for undoing.
+        vector<int> trail_;
+
+        // Constraints to check for propagation.
+        vector<int> pending_;
+
+        vector<uint8_t> seen_mine_;
+        vector<uint8_t> seen_safe_;
+        int seen_both_count_;
+
+        int64_t node_count_;
+
+        bool stopped_;
+
+        bool timeout_;
+
+        bool Assign(int variable, int value) {
+            values_[variable] = value;
+            trail_.push_back(variable);
+            bool result = true;
+            for (int constraint: variable_constraints_[variable]) {
+                --unassigned_[constraint];
+                remaining_[constraint] -= value;
+                if (remaining_[constraint] < 0 || remaining_[constraint] > unassigned_[constraint]) {
+                    result = false;
+                }
+                pending_.push_back(constraint);
+            }
+            return result;
+        }
+
+        void Undo(size_t trail_size) {
+            while (trail_.size() > trail_size) {
+                int variable = trail_.back();
+                trail_.pop_back();
+                for (int constraint: variable_constraints_[variable]) {
+                    ++unassigned_[constraint];
+                    remaining_[constraint] += values_[variable];
+                }
+                values_[variable] = -1;
+            }
+        }
+
+        // Assigns every variable of a saturated constraint until nothing changes. Returns false on a conflict.
+        bool Propagate() {
+            while (!pending_.empty()) {
+                int constraint = pending_.back();
+                pending_.pop_back();
+                if (unassigned_[constraint] == 0) {
+                    continue;
+                }
+                int value;
+                if (remaining_[constraint] == 0) {
+                    value = 0;
+                } else if (remaining_[constraint] == unassigned_[constraint]) {
+                    value = 1;
+                } else {
+                    continue;
+                }
+                for (auto [variable, coefficient]: constraints_[constraint].entries) {
+                    if (values_[variable] == -1 && !Assign(variable, value)) {
+                        pending_.clear();
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        void Record() {
+            ++legal_count;
+            for (int variable = 0; variable < variable_count_; ++variable) {
+                uint8_t& seen = values_[variable] ? seen_mine_[variable] : seen_safe_[variable];
+                if (!seen) {
+                    seen = true;
+                    seen_both_count_ += seen_mine_[variable] && seen_safe_[variable];
+                }
+                count[variable] += values_[variable];
+            }
+            if (early_exit_ && seen_both_count_ == variable_count_) {
+                stopped_ = true;
+            }
+        }
+
+        // Variables are tried in index order, which follows the frontier.
+        void Search(int cursor) {
+            if (++node_count_ % kEnumerateCheckInterval == 0 && timer_.TimeIsUp()) {
+                stopped_ = timeout_ = true;
+            }
+            if (stopped_) {
+                return;
+            }
+            while (cursor < variable_count_ && values_[cursor] != -1) {
+                ++cursor;
+            }
+            if (cursor == variable_count_) {
+                Record();
+                return;
+            }
+            for (int value = 0; value <= 1 && !stopped_; ++value) {
+                size_t trail_size = trail_.size();
+                if (Assign(cursor, value) && Propagate()) {
+                    Search(cursor + 1);
+                } else {
+                    pending_.clear();
+                }
+                Undo(trail_size);
+            }
+        }
+
+    public:
+        int64_t legal_count;
+
+        vector<int64_t> count;
+
+        MineBacktracker(const SparseMatrix& constraints, int variable_count, bool early_exit, Timer& timer) :
+            constraints_(constraints),
+            variable_count_(variable_count),
+            early_exit_(early_exit),
+            timer_(timer),
+            variable_constraints_(variable_count),
+            values_(variable_count, -1),
+            remaining_(constraints.size()),
+            unassigned_(constraints.size()),
+            seen_mine_(variable_count, false),
+            seen_safe_(variable_count, false),
+            seen_both_count_(0),
+            node_count_(0),
+            stopped_(false),
+            timeout_(false),
+            legal_count(0),
+            count(variable_count, 0) {
+            for (int constraint = 0; constraint < (int)constraints.size(); ++constraint) {
+                for (auto [variable, coefficient]: constraints[constraint].entries) {
+                    assert(coefficient == 1);
+                    variable_constraints_[variable].push_back(constraint);
+                }
+                remaining_[constraint] = constraints[constraint].value;
+                unassigned_[constraint] = constraints[constraint].entries.size();
+            }
+        }
+
+        // Returns false on timeout.
+        bool Run() {
+            for (int constraint = 0; constraint < (int)constraints_.size(); ++constraint) {
+                if (remaining_[constraint] < 0 || remaining_[constraint] > unassigned_[constraint]) {
+                    return true;
+                }
+                pending_.push_back(constraint);
+            }
+            if (Propagate()) {
+                Search(0);
+            }
+            return !timeout_;
+        }
+    };
+
+    /**
+        @brief Counts the solutions of a region's original constraints, like EnumerateMine() does on the reduced system.
+        @param constraints The region's constraints before elimination, with coefficients of 1.
+        @param early_exit Stops once every variable has been seen both as mine and as safe. The counts are then
+            partial, but no variable looks forced, which is the truth at that point.
+
+        Saturated constraints assign their variables at once and a constraint needing more mines than it has cells
+        fails at once, so whole subtrees that brute force would enumerate are never visited.
+    */
+    std::pair<int64_t, vector<int64_t>> BacktrackMine(const SparseMatrix& constraints, int variable_count, Timer& timer, bool early_exit = false) {
+        MineBacktracker backtracker(constraints, variable_count, early_exit, timer);
+        if (!backtracker.Run()) {
+            if (kPrintDebugInfo) {
+                std::cerr << "BacktrackMine Timeout!" << std::endl;
+            }
+            return {};
+        }
+        return {backtracker.legal_count, backtracker.count};
+    }
+
+    // Chooses how SolveRegion() finds forced grids when elimination alone finds none.
+    enum EnumerateEngine {
+        // EnumerateMine() on the reduced system.
+        kEnumerate,
+        // BacktrackMine() on the original constraints.
+        kBacktrack,
+        // CountMineByFrontier() on the original constraints.
+        kFrontierDP,
+    };
+
+    // Options of SolveRegion(), SolveOneStep(), Solver and Solvable().
+    struct SolveOptions {
+        EnumerateEngine engine = EnumerateEngine::kEnumerate;
+
+        // With kEnumerate, reduced regions with more free variables than this are counted by CountMineByFrontier().
+        int frontier_dp_threshold = 24;
+
+        // Lets Solver fall back to ComputeMineProbability() with the total number of mines when regions alone are stuck.
+        bool use_mine_count = false;
+
+        // Lets SolveOneStep() and Solver look up kPatternTable before building any region.
+        bool use_patterns = true;
+
+        // If not null, regions reaching elimination are memoized here. It may be shared between threads.
+        RegionCache* region_cache = nullptr;
+
+        // The number of threads solving the regions of a step, the calling one included.
+        // Above 1, SharedThreadPool() lends the others.
+        int thread_count = 1;
+    };
+
+    // How often one tier of SolveRegion() ran, and how often it deduced something.
+    struct TierStatistics {
+        // The number of regions the tier ran on.
+        int64_t runs = 0;
+
+        // The number of regions the tier deduced something in.
+        int64_t hits = 0;
+
+        // The number of grids the tier deduced.
+        int64_t deductions = 0;
+
+        void Record(size_t deduced) {
+            ++runs;
+            hits += deduced != 0;
+            deductions += deduced;
+        }
+
+        double HitRate() const {
+            return runs == 0 ? 0.0 : (double)hits / runs;
+        }
+    };
+
+    // Statistics of the tiers of SolveRegion(). Each tier only runs on the regions the previous ones left unsolved.
+    struct SolveStatistics {
+        // The pattern lookup in front of the regions, counted per pass over the board rather than per region.
+        TierStatistics pattern;
+
+        TierStatistics saturation;
+        TierStatistics pair;
+        TierStatistics elimination;
+        TierStatistics enumeration;
+
+        SolveStatistics& operator+=(const SolveStatistics& rhs) {
+            for (auto [tier, rhs_tier]: {
+                std::make_pair(&pattern, &rhs.pattern),
+                std::make_pair(&saturation, &rhs.saturation),
+                std::make_pair(&pair, &rhs.pair),
+                std::make_pair(&elimination, &rhs.elimination),
+                std::make_pair(&enumeration, &rhs.enumeration),
+            }) {
+                tier->runs += rhs_tier->runs;
+                tier->hits += rhs_tier->hits;
+                tier->deductions += rhs_tier->deductions;
+            }
+            return *this;
+        }
+
+        void Print(std::ostream& stream) const {
+            auto print = [&stream](const char* name, const TierStatistics& tier) {
+                stream << name << ": " << tier.hits << '/' << tier.runs << " regions (" << tier.HitRate() * 100
+                    << "%), " << tier.deductions << " grids" << std::endl;
+            };
+            print("pattern", pattern);
+            print("saturation", saturation);
+            print("pair", pair);
+            print("elimination", elimination);
+            print("enumeration", enumeration);
+        }
+    };
+
+    // The first tier: a constraint whose mines are all flaged has only safe grids left,
+    // and one needing as many mines as it has unknown grids has only mines left. Sets `solved` to the forced grids.
+    void SolveBySaturation(const SparseMatrix& constraints, vector<std::pair<int, int>>& solved) {
+        solved.clear();
+        for (const SparseRow& row: constraints) {
+            if (row.value != 0 && row.value != (int)row.entries.size()) {
+                continue;
+            }
+            for (auto [variable, coefficient]: row.entries) {
+                solved.emplace_back(variable, row.value != 0);
+            }
+        }
+        std::sort(solved.begin(), solved.end());
+        solved.erase(std::unique(solved.begin(), solved.end()), solved.end());
+    }
+
+    /**
+        @brief The second tier: compares every two constraints sharing a variable.
+        @param constraints A region's constraints before elimination, with coefficients of 1 and sorted entries.
+
+        Splitting the variables of constraints `a` and `b` into only-a, shared and only-b, the mines in the shared
+        part are at least max(a - |only-a|, b - |only-b|) and at most min(a, b, |shared|). If the rest of `a` must
+        take all of only-a, or none of it, only-a is solved, and the same for `b`. This covers the subset rule
+        (only-a empty) and the classic 1-2 patterns. Sets `solved` to the forced grids.
+    */
+    void SolveByPairs(const SparseMatrix& constraints, int variable_count, vector<std::pair<int, int>>& solved) {
+        // Per-thread buffers, so that regions are compared without allocating. `rows_of` only grows.
+        static thread_local vector<vector<int>> rows_of;
+        static thread_local vector<int> only_a, only_b, compared;
+        if ((int)rows_of.size() < variable_count) {
+            rows_of.resize(variable_count);
+        }
+        for (int variable = 0; variable < variable_count; ++variable) {
+            rows_of[variable].clear();
+        }
+        for (size_t index = 0; index < constraints.size(); ++index) {
+            for (auto [variable, coefficient]: constraints[index].entries) {
+                assert(coefficient == 1);
+                rows_of[variable].push_back(index);
+            }
+        }
+
+        solved.clear();
+        compared.assign(constraints.size(), -1);
+        for (size_t a = 0; a < constraints.size(); ++a) {
+            const SparseRow& row_a = constraints[a];
+            for (auto [shared_variable, coefficient]: row_a.entries) {
+                for (int b: rows_of[shared_variable]) {
+                    if (b <= (int)a || compared[b] == (int)a) {
+                        continue;
+                    }
+                    compared[b] = a;
+                    const SparseRow& row_b = constraints[b];
+                    only_a.clear();
+                    only_b.clear();
+                    int shared_count = 0;
+                    auto it_a = row_a.entries.cbegin(), it_b = row_b.entries.cbegin();
+                    while (it_a != row_a.entries.cend() || it_b != row_b.entries.cend()) {
+                        if (it_b == row_b.entries.cend() || (it_a != row_a.entries.cend() && it_a->first < it_b->first)) {
+                            only_a.push_back((it_a++)->first);
+                        } else if (it_a == row_a.entries.cend() || it_b->first < it_a->first) {
+                            only_b.push_back((it_b++)->first);
+                        } else {
+                            ++shared_count;
+                            ++it_a;
+                            ++it_b;
+                        }
+                    }
+                    int shared_min = std::max({row_a.value - (int)only_a.size(), row_b.value - (int)only_b.size(), 0});
+                    int shared_max = std::min({row_a.value, row_b.value, shared_count});
+                    auto settle = [&solved, shared_min, shared_max](const vector<int>& only, int value) {
+                        if (only.empty()) {
+                            return;
+                        }
+                        if (value - shared_max == (int)only.size() || value - shared_min == 0) {
+                            for (int variable: only) {
+                                solved.emplace_back(variable, value - shared_max == (int)only.size());
+                            }
+                        }
+                    };
+                    settle(only_a, row_a.value);
+                    settle(only_b, row_b.value);
+                }
+            }
+        }
+        std::sort(solved.begin(), solved.end());
+        solved.erase(std::unique(solved.begin(), solved.end()), solved.end());
+    }
+
+    // The last two tiers of SolveRegion(): elimination, then enumeration by the engine in `options`.
+    // Returns false if elimination finds that the region has no solution.
+    bool SolveRegionExactly(Region& region, vector<std::pair<int, int>>& solved, Timer& timer, const SolveOptions& options, SolveStatistics* statistics) {
+        int variable_count = region.first.size();
+        // Per-thread, so that copies and counts reuse the storage of the previous regions.
+        static thread_local SparseMatrix constraints;
+        static thread_local vector<int64_t> enumerated_count;
+        if (options.engine != EnumerateEngine::kEnumerate || variable_count > options.frontier_dp_threshold) {
+            constraints = region.second;
+        }
+        if (!GaussianElimination(region.second, variable_count, solved)) {
+            if (kPrintDebugInfo) {
+                std::clog << "SolveRegion Inconsistent!" << std::endl;
+            }
+            return false;
+        }
+        if (statistics) {
+            statistics->elimination.Record(solved.size());
+        }
+        if (!solved.empty()) {
+            return true;
+        }
+
+        ScopedStage stage(Stage::kEnumeration);
+        int free_variable_count = variable_count - region.second.size();
+        if (options.engine == EnumerateEngine::kFrontierDP || (options.engine == EnumerateEngine::kEnumerate && free_variable_count > options.frontier_dp_threshold)) {
+            auto [legal_count, count] = CountMineByFrontier(constraints, variable_count, timer);
+            for (size_t index = 0; index < count.size() && !legal_count.IsZero(); ++index) {
+                if (count[index].IsZero()) {
+                    solved.emplace_back(index, 0);
+                } else if (count[index] == legal_count) {
+                    solved.emplace_back(index, 1);
+                }
+            }
+        } else {
+            int64_t legal_count;
+            if (options.engine == EnumerateEngine::kBacktrack) {
+                std::tie(legal_count, enumerated_count) = BacktrackMine(constraints, variable_count, timer, true);
+            } else {
+                legal_count = EnumerateMine(region.second, variable_count, timer, enumerated_count);
+            }
+            for (size_t index = 0; index < enumerated_count.size() && legal_count; ++index) {
+                if (enumerated_count[index] == 0) {
+                    solved.emplace_back(index, 0);
+                } else if (enumerated_count[index] == legal_count) {
+                    solved.emplace_back(index, 1);
+                }
+            }
+        }
+        if (statistics) {
+            statistics->enumeration.Record(solved.size());
+        }
+        return true;
+    }
+
+    /**
+        @brief Sets `solved` to the forced grids of a region as (index in `region.first`, whether it is mine).
+        @param statistics If not null, records which tier solved the region.
+        @return False if the region has no solution, as when a grid was flaged wrongly. `solved` is then empty.
+
+        The region goes through the tiers from the cheapest: saturation, pairs, elimination and enumeration
+        (by the engine in `options`), and stops at the first one deducing anything. Regions reaching elimination
+        are looked up in `options.region_cache` first, if any, and their results are stored there.
+        Up to a cache hit, nothing is allocated once `solved` and the per-thread buffers are large enough.
+    */
+    bool SolveRegion(Region& region, vector<std::pair<int, int>>& solved, Timer& timer, const SolveOptions& options = {}, SolveStatistics* statistics = nullptr) {
+        int variable_count = region.first.size();
+        SolveBySaturation(region.second, solved);
+        if (statistics) {
+            statistics->saturation.Record(solved.size());
+        }
+        if (!solved.empty()) {
+            return true;
+        }
+        SolveByPairs(region.second, variable_count, solved);
+        if (statistics) {
+            statistics->pair.Record(solved.size());
+        }
+        if (!solved.empty()) {
+            return true;
+        }
+
+        RegionCache* cache = options.region_cache;
+        if (!cache || variable_count > cache->max_variable_count()) {
+            return SolveRegionExactly(region, solved, timer, options, statistics);
+        }
+        static thread_local CanonicalRegion canonical;
+        CanonicalizeRegion(region, canonical);
+        if (cache->Lookup(canonical.key, solved)) {
+            for (auto& [variable, type]: solved) {
+                variable = canonical.order[variable];
+            }
+            return true;
+        }
+        // Regions without a solution are not cached, so a hit is always a consistent result.
+        if (!SolveRegionExactly(region, solved, timer, options, statistics)) {
+            return false;
+        }
+        if (!timer.TimeIsUp()) {
+            vector<int> rank(variable_count);
+            for (int index = 0; index < variable_count; ++index) {
+                rank[canonical.order[index]] = index;
+            }
+            vector<std::pair<int, int>> canonical_solved(solved);
+            for (auto& [variable, type]: canonical_solved) {
+                variable = rank[variable];
+            }
+            cache->Insert(canonical.key, std::move(canonical_solved));
+        }
+        return true;
+    }
+
+    // Returns the forced grids of a region as (index in `region.first`, whether it is mine), none if it has no solution.
+    vector<std::pair<int, int>> SolveRegion(Region& region, Timer& timer, const SolveOptions& options = {}, SolveStatistics* statistics = nullptr) {
+        vector<std::pair<int, int>> solved;
+        SolveRegion(region, solved, timer, options, statistics);
+        return solved;
+    }
+
+    /**
+        @brief Solves independent regions, the largest first, on up to `options.thread_count` threads.
+        @param results Set to the result of SolveRegion() for each region, in the order of `regions` whatever thread
+            solved it. Regions not started before the timer is up give no deduction.
+        @return False if some region has no solution.
+
+        The calling thread takes regions too, so the step finishes even if every pool worker is busy, and
+        waits only for regions already taken. Shared state is kept alive by the helper tasks, since a helper
+        may start after the step is over; it then finds no region left and returns.
+    */
+    bool SolveRegions(vector<Region>& regions, vector<vector<std::pair<int, int>>>& results, Timer& timer, const SolveOptions& options = {}, SolveStatistics* statistics = nullptr) {
+        int region_count = regions.size();
+        results.assign(region_count, {});
+        if (options.thread_count <= 1 || region_count <= 1) {
+            for (int index = 0; index < region_count; ++index) {
+                if (timer.TimeIsUp()) {
+                    if (kPrintDebugInfo) {
+                        std::clog << "SolveRegions Timeout!" << std::endl;
+                    }
+                    break;
+                }
+                if (!SolveRegion(regions[index], results[index], timer, options, statistics)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        struct SharedState {
+            // Set before any helper starts. A helper starting after the step must not read `regions`,
+            // which the caller takes back.
+            int region_count;
+            vector<Region> regions;
+            vector<int> order;
+            vector<vector<std::pair<int, int>>> results;
+            vector<SolveStatistics> statistics;
+            SolveOptions options;
+            Timer* timer;
+            std::atomic<bool> inconsistent{false};
+            std::atomic<int> next{0};
+            int completed = 0;
+            std::mutex mutex;
+            std::condition_variable all_completed;
+        };
+        auto state = std::make_shared<SharedState>();
+        state->regions.swap(regions);
+        state->order.resize(region_count);
+        std::iota(state->order.begin(), state->order.end(), 0);
+        std::stable_sort(state->order.begin(), state->order.end(), [&state](int lhs, int rhs) {
+            return state->regions[lhs].first.size() > state->regions[rhs].first.size();
+        });
+        state->results.resize(region_count);
+        state->statistics.resize(region_count);
+        state->options = options;
+        state->timer = &timer;
+        state->region_count = region_count;
+
+        auto work = [](SharedState& state) {
+            int region_count = state.region_count;
+            for (int taken = state.next++; taken < region_count; taken = state.next++) {
+                int index = state.order[taken];
+                if (!state.timer->TimeIsUp() && !state.inconsistent
+                    && !SolveRegion(state.regions[index], state.results[index], *state.timer, state.options, &state.statistics[index])) {
+                    state.inconsistent = true;
+                }
+                std::lock_guard<std::mutex> lock(state.mutex);
+                if (++state.completed == region_count) {
+                    state.all_completed.notify_all();
+                }
+            }
+        };
+        int helper_count = std::min(options.thread_count, region_count) - 1;
+        for (int i = 0; i < helper_count; ++i) {
+            SharedThreadPool().Execute([state, work] {
+                work(*state);
+            });
+        }
+        work(*state);
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->all_completed.wait(lock, [&state, region_count] {
+                return state->completed == region_count;
+            });
+        }
+
+        regions.swap(state->regions);
+        for (int index = 0; index < region_count; ++index) {
+            if (statistics) {
+                *statistics += state->statistics[index];
+            }
+            results[index].swap(state->results[index]);
+        }
+        return !state->inconsistent;
+    }
+
+    // Looks up every two adjacent numbers in kPatternTable and applies what they force. Returns whether anything was.
+    bool SolveByPatterns(int row_count, int column_count, Matrix<std::pair<GridState, int>>& states, SolveStatistics* statistics = nullptr) {
+        vector<std::pair<std::pair<int, int>, int>> solved;
+        for (int row = 1; row <= row_count; ++row) {
+            for (int column = 1; column <= column_count; ++column) {
+                if (states[row][column].first != GridState::kOpened) {
+                    continue;
+                }
+                for (bool vertical: {false, true}) {
+                    int other_row = row + vertical, other_column = column + !vertical;
+                    if (!Inside(other_row, other_column, row_count, column_count) || states[other_row][other_column].first != GridState::kOpened) {
+                        continue;
+                    }
+                    PatternDeduction deduction = MatchPattern(states[row][column].second, states[other_row][other_column].second, vertical,
+                        [&](int row_offset, int column_offset) {
+                            return Inside(row + row_offset, column + column_offset, row_count, column_count)
+                                ? states[row + row_offset][column + column_offset].first : GridState::kOpened;
+                        });
+                    for (int cell = 0; cell < kPatternCellCount; ++cell) {
+                        if ((deduction.safe | deduction.mine) >> cell & 1) {
+                            auto [row_offset, column_offset] = PatternOffset(cell, vertical);
+                            solved.emplace_back(std::make_pair(row + row_offset, column + column_offset), deduction.mine >> cell & 1);
+                        }
+                    }
+                }
+            }
+        }
+        std::sort(solved.begin(), solved.end());
+        solved.erase(std::unique(solved.begin(), solved.end()), solved.end());
+        if (statistics) {
+            statistics->pattern.Record(solved.size());
+        }
+        for (auto [position, type]: solved) {
+            states[position.first][position.second].first = type ? GridState::kFlaged : GridState::kOpened;
+        }
+        return !solved.empty();
+    }
+
+    bool SolveOneStep(int row_count, int column_count, Matrix<std::pair<GridState, int>>& states, Timer& timer, const SolveOptions& options = {}, SolveStatistics* statistics = nullptr) {
+        if (kPrintDebugInfo) {
+            std::clog << "\nSolveOneStep" << std::endl;
+        }
+
+        assert((int)states.size() == row_count + 1);
+        for (int row = 1; row <= row_count; ++row) {
+            assert((int)states[row].size() == column_count + 1);
+        }
+        if (options.use_patterns && SolveByPatterns(row_count, column_count, states, statistics)) {
+            return true;
+        }
+        vector<Region> regions = Divide(row_count, column_count, states);
+        ShuffleVector(regions);
+        RecordDistribution(Distribution::kRegionsPerStep, regions.size());
+
+        if (kPrintDebugInfo) {
+            std::clog << "regions: " << regions.size() << 'x' << std::endl;
+
+            for (const auto& region: regions) {
+                std::clog << "region:\nPositions:";
+
+                for (auto [row, column]: region.first) {
+                    std::clog << " (" << row << ", " << column << ')';
+                }
+
+                std::clog << std::endl << "Matrix: " << region.second.size() << " x " << region.first.size() << std::endl;
+                for (const auto& row: region.second) {
+                    for (auto [variable, coefficient]: row.entries) {
+                        std::clog << coefficient << "x" << variable << ' ';
+                    }
+                    std::clog << "= " << row.value << std::endl;
+                }
+            }
+        }
+
+        bool result = false;
+        vector<vector<std::pair<int, int>>> solved;
+        if (!SolveRegions(regions, solved, timer, options, statistics)) {
+            return false;
+        }
+        for (size_t region = 0; region < regions.size(); ++region) {
+            for (auto [index, type]: solved[region]) {
+                auto [row, column] = regions[region].first[index];
+                states[row][column].first = type ? GridState::kFlaged : GridState::kOpened;
+                result = true;
+            }
+        }
+        return result;
+    }
+
+    // Keeps the solving state of a board between steps.
+    // Only regions containing a constraint touched since the last step are rebuilt and solved again,
+    // since an untouched region gives the same (empty) result as before.
+    class Solver {
+    private:
+        // The board being solved. Its states are updated as grids are opened or flaged.
+        Board board_;
+
+        SolveOptions options_;
+
+        // The number of unknown grids.
+        int unknown_count_ = 0;
+
+        // The total number of mines.
+        int mine_count_ = 0;
+
+        // Whether a buffer index is on the sentinel border.
+        vector<uint8_t> border_;
+
+        // The number of unknown and flaged neighbours of each grid.
+        vector<uint8_t> unknown_neighbours_;
+        vector<uint8_t> flaged_neighbours_;
+
+        // Opened grids whose constraint changed since the last step.
+        vector<int> dirty_;
+        vector<uint8_t> is_dirty_;
+
+        // Opened grids whose constraint changed since the last pattern lookup.
+        // Kept apart from `dirty_`, since a step ending at the patterns leaves the regions unsolved.
+        vector<int> pattern_pending_;
+        vector<uint8_t> is_pattern_pending_;
+
+        // Marks the grids visited while building regions in the current step.
+        vector<int> visited_;
+        int visit_stamp_ = 0;
+
+        // The index of each unknown grid in its region.
+        vector<int> variable_index_;
+
+        // Deductions of the current step as (buffer index, whether it is mine).
+        vector<std::pair<int, int>> deductions_;
+
+        // Buffers of the current step. They keep their memory between steps and boards, so that
+        // a solver reused through Reset() stops allocating once they are large enough.
+        vector<int> step_dirty_;
+        vector<int> step_pattern_pending_;
+        vector<int> open_pending_;
+        vector<int> constraints_;
+        vector<Region> regions_;
+        vector<std::pair<int, int>> solved_;
+
+        // Regions and rows of earlier steps, emptied but with their memory.
+        vector<Region> spare_regions_;
+        vector<SparseRow> spare_rows_;
+
+        SolveStatistics statistics_;
+
+        bool IsConstraint(int index) const {
+            return !border_[index] && board_.cell(index).IsOpened() && unknown_neighbours_[index] > 0;
+        }
+
+        void MarkDirty(int index) {
+            if (!IsConstraint(index)) {
+                return;
+            }
+            if (!is_dirty_[index]) {
+                is_dirty_[index] = true;
+                dirty_.push_back(index);
+            }
+            if (!is_pattern_pending_[index]) {
+                is_pattern_pending_[index] = true;
+                pattern_pending_.push_back(index);
+            }
+        }
+
+        // Looks up each constraint touched since the last lookup with its adjacent numbers in kPatternTable.
+        void MatchPatterns() {
+            step_pattern_pending_.swap(pattern_pending_);
+            pattern_pending_.clear();
+            int stride = board_.stride();
+            for (int index: step_pattern_pending_) {
+                is_pattern_pending_[index] = false;
+                if (!IsConstraint(index)) {
+                    continue;
+                }
+                for (int offset: {1, stride, -1, -stride}) {
+                    if (!IsConstraint(index + offset)) {
+                        continue;
+                    }
+                    int a = std::min(index, index + offset), b = std::max(index, index + offset);
+                    bool vertical = b - a != 1;
+                    PatternDeduction deduction = MatchPattern(board_.cell(a).mine_count(), board_.cell(b).mine_count(), vertical,
+                        [&](int row_offset, int column_offset) {
+                            return board_.cell(a + row_offset * stride + column_offset).state();
+                        });
+                    for (int cell = 0; cell < kPatternCellCount; ++cell) {
+                        if ((deduction.safe | deduction.mine) >> cell & 1) {
+                            auto [row_offset, column_offset] = PatternOffset(cell, vertical);
+                            deductions_.emplace_back(a + row_offset * stride + column_offset, deduction.mine >> cell & 1);
+                        }
+                    }
+                }
+            }
+            std::sort(deductions_.begin(), deductions_.end());
+            deductions_.erase(std::unique(deductions_.begin(), deductions_.end()), deductions_.end());
+            statistics_.pattern.Record(deductions_.size());
+        }
+
+        // Applies the deductions of the current step. Returns whether there were any.
+        bool ApplyDeductions() {
+            for (auto [index, type]: deductions_) {
+                if (type) {
+                    Flag(board_.Row(index), board_.Column(index));
+                } else {
+                    Open(board_.Row(index), board_.Column(index));
+                }
+            }
+            return !deductions_.empty();
+        }
+
+        // Updates the neighbours of a grid that was unknown, and marks their constraints dirty.
+        void Resolve(int index, bool flaged) {
+            --unknown_count_;
+            for (int direction = 0; direction < 8; ++direction) {
+                int next = index + board_.neighbour_offset(direction);
+                --unknown_neighbours_[next];
+                if (flaged) {
+                    ++flaged_neighbours_[next];
+                }
+                MarkDirty(next);
+            }
+        }
+
+        // Adds an empty region to `regions_`, reusing a spare one.
+        Region& NewRegion() {
+            if (spare_regions_.empty()) {
+                return regions_.emplace_back();
+            }
+            regions_.push_back(std::move(spare_regions_.back()));
+            spare_regions_.pop_back();
+            return regions_.back();
+        }
+
+        // Empties the regions of the step into the spares.
+        void RecycleRegions() {
+            for (Region& region: regions_) {
+                region.first.clear();
+                for (SparseRow& row: region.second) {
+                    spare_rows_.push_back(std::move(row));
+                }
+                region.second.clear();
+                spare_regions_.push_back(std::move(region));
+            }
+            regions_.clear();
+        }
+
+        // Collects the region containing constraint `start` into `region`, numbering unknown grids in search order.
+        void BuildRegion(int start, Region& region, vector<int>& constraints) {
+            Positions& unknown_positions = region.first;
+            constraints.assign(1, start);
+            visited_[start] = visit_stamp_;
+            for (size_t head = 0; head < constraints.size(); ++head) {
+                int constraint = constraints[head];
+                for (int direction = 0; direction < 8; ++direction) {
+                    int unknown = constraint + board_.neighbour_offset(direction);
+                    if (!board_.cell(unknown).IsUnknown() || visited_[unknown] == visit_stamp_) {
+                        continue;
+                    }
+                    visited_[unknown] = visit_stamp_;
+                    variable_index_[unknown] = unknown_positions.size();
+                    unknown_positions.emplace_back(board_.Row(unknown), board_.Column(unknown));
+                    for (int next_direction = 0; next_direction < 8; ++next_direction) {
+                        int next = unknown + board_.neighbour_offset(next_direction);
+                        if (visited_[next] != visit_stamp_ && IsConstraint(next)) {
+                            visited_[next] = visit_stamp_;
+                            constraints.push_back(next);
+                        }
+                    }
+                }
+            }
+
+            SparseMatrix& gauss_matrix = region.second;
+            for (int constraint: constraints) {
+                SparseRow equation;
+                if (!spare_rows_.empty()) {
+                    equation = std::move(spare_rows_.back());
+                    spare_rows_.pop_back();
+                    equation.entries.clear();
+                }
+                // A constraint has at most 8 unknown grids, so a row is allocated at most once.
+                equation.entries.reserve(8);
+                for (int direction = 0; direction < 8; ++direction) {
+                    int next = constraint + board_.neighbour_offset(direction);
+                    if (board_.cell(next).IsUnknown()) {
+                        equation.entries.emplace_back(variable_index_[next], 1);
+                    }
+                }
+                std::sort(equation.entries.begin(), equation.entries.end());
+                equation.value = board_.cell(constraint).mine_count() - flaged_neighbours_[constraint];
+                gauss_matrix.emplace_back(std::move(equation));
+            }
+        }
+
+    public:
+        // Starts with no board. Reset() gives it one.
+        Solver() = default;
+
+        explicit Solver(const Board& board, const SolveOptions& options = {}) : options_(options) {
+            Reset(board);
+        }
+
+        // Starts solving a new board with other options.
+        void Reset(const Board& board, const SolveOptions& options) {
+            options_ = options;
+            Reset(board);
+        }
+
+        // Starts solving a new board.
+        void Reset(const Board& board) {
+            board_ = board;
+            size_t size = board_.cells().size();
+            border_.assign(size, true);
+            unknown_neighbours_.assign(size, 0);
+            flaged_neighbours_.assign(size, 0);
+            is_dirty_.assign(size, false);
+            is_pattern_pending_.assign(size, false);
+            visited_.assign(size, 0);
+            variable_index_.assign(size, -1);
+            dirty_.clear();
+            pattern_pending_.clear();
+            visit_stamp_ = 0;
+            unknown_count_ = 0;
+            mine_count_ = 0;
+
+            for (int row = 1; row <= board_.row_count(); ++row) {
+                for (int column = 1; column <= board_.column_count(); ++column) {
+                    int index = board_.Index(row, column);
+                    border_[index] = false;
+                    Grid grid = board_.cell(index);
+                    mine_count_ += grid.is_mine();
+                    if (!grid.IsUnknown() && !grid.IsFlaged()) {
+                        continue;
+                    }
+                    unknown_count_ += grid.IsUnknown();
+                    for (int direction = 0; direction < 8; ++direction) {
+                        int next = index + board_.neighbour_offset(direction);
+                        unknown_neighbours_[next] += grid.IsUnknown();
+                        flaged_neighbours_[next] += grid.IsFlaged();
+                    }
+                }
+            }
+            for (int row = 1; row <= board_.row_count(); ++row) {
+                for (int column = 1; column <= board_.column_count(); ++column) {
+                    MarkDirty(board_.Index(row, column));
+                }
+            }
+        }
+
+        const Board& board() const {
+            return board_;
+        }
+
+        int unknown_count() const {
+            return unknown_count_;
+        }
+
+        int mine_count() const {
+            return mine_count_;
+        }
+
+        bool Solved() const {
+            return unknown_count_ == 0;
+        }
+
+        // The tier statistics of every step since the construction. Reset() keeps them, so they can add up over boards.
+        const SolveStatistics& statistics() const {
+            return statistics_;
+        }
+
+        // Opens an unknown grid which is not mine, together with the empty area around it.
+        void Open(int row, int column) {
+            int index = board_.Index(row, column);
+            if (!board_.cell(index).IsUnknown()) {
+                return;
+            }
+            assert(!board_.cell(index).is_mine());
+            vector<int>& pending = open_pending_;
+            pending.assign(1, index);
+            board_.cell_ref(index).set_state(GridState::kOpened);
+            while (!pending.empty()) {
+                int current = pending.back();
+                pending.pop_back();
+                Resolve(current, false);
+                MarkDirty(current);
+                if (board_.cell(current).mine_count() != 0) {
+                    continue;
+                }
+                for (int direction = 0; direction < 8; ++direction) {
+                    int next = current + board_.neighbour_offset(direction);
+                    if (board_.cell(next).IsUnknown()) {
+                        assert(!board_.cell(next).is_mine());
+                        board_.cell_ref(next).set_state(GridState::kOpened);
+                        pending.push_back(next);
+                    }
+                }
+            }
+        }
+
+        // Moves a mine between two unknown grids of the board being solved, and marks the constraints around both dirty.
+        // Grids opened or flaged before stay so, but the deductions that led to them may no longer hold.
+        void MoveMine(int from_row, int from_column, int to_row, int to_column) {
+            int from = board_.Index(from_row, from_column), to = board_.Index(to_row, to_column);
+            assert(board_.cell(from).IsUnknown() && board_.cell(to).IsUnknown());
+            board_.MoveMine(from_row, from_column, to_row, to_column);
+            for (int direction = 0; direction < 8; ++direction) {
+                MarkDirty(from + board_.neighbour_offset(direction));
+                MarkDirty(to + board_.neighbour_offset(direction));
+            }
+        }
+
+        // Flags an unknown grid which is mine.
+        void Flag(int row, int column) {
+            int index = board_.Index(row, column);
+            if (!board_.cell(index).IsUnknown()) {
+                return;
+            }
+            assert(board_.cell(index).is_mine());
+            board_.cell_ref(index).set_state(GridState::kFlaged);
+            Resolve(index, true);
+        }
+
+        // Looks up the patterns around the constraints touched since the last step, or if they force nothing,
+        // solves every region touched since the last region solving. Applies the deductions and returns whether
+        // anything was deduced; a step finding a region without solution deduces nothing.
+        bool Step(Timer& timer) {
+            ScopedStage step_stage(Stage::kStep);
+            deductions_.clear();
+            if (options_.use_patterns) {
+                MatchPatterns();
+                if (ApplyDeductions()) {
+                    return true;
+                }
+            }
+            ++visit_stamp_;
+            step_dirty_.swap(dirty_);
+            dirty_.clear();
+            for (int index: step_dirty_) {
+                is_dirty_[index] = false;
+            }
+            {
+                ScopedStage divide_stage(Stage::kDivide);
+                for (int index: step_dirty_) {
+                    if (visited_[index] == visit_stamp_ || !IsConstraint(index)) {
+                        continue;
+                    }
+                    if (timer.TimeIsUp()) {
+                        if (kPrintDebugInfo) {
+                            std::clog << "Solver::Step Timeout!" << std::endl;
+                        }
+                        break;
+                    }
+                    BuildRegion(index, NewRegion(), constraints_);
+                }
+            }
+            if (InstrumentationEnabled()) {
+                RecordDistribution(Distribution::kRegionsPerStep, regions_.size());
+                for (const Region& region: regions_) {
+                    RecordDistribution(Distribution::kRegionSize, region.first.size());
+                }
+            }
+            bool consistent = true;
+            if (options_.thread_count <= 1 || regions_.size() <= 1) {
+                // Solved here rather than by SolveRegions(), so that no result is allocated.
+                for (Region& region: regions_) {
+                    if (timer.TimeIsUp()) {
+                        break;
+                    }
+                    if (!SolveRegion(region, solved_, timer, options_, &statistics_)) {
+                        consistent = false;
+                        break;
+                    }
+                    for (auto [variable, type]: solved_) {
+                        auto [row, column] = region.first[variable];
+                        deductions_.emplace_back(board_.Index(row, column), type);
+                    }
+                }
+            } else {
+                vector<vector<std::pair<int, int>>> solved;
+                consistent = SolveRegions(regions_, solved, timer, options_, &statistics_);
+                for (size_t region = 0; region < regions_.size(); ++region) {
+                    for (auto [variable, type]: solved[region]) {
+                        auto [row, column] = regions_[region].first[variable];
+                        deductions_.emplace_back(board_.Index(row, column), type);
+                    }
+                }
+            }
+            RecycleRegions();
+            if (!consistent) {
+                deductions_.clear();
+                return false;
+            }
+            if (deductions_.empty() && options_.use_mine_count && unknown_count_ != 0 && !timer.TimeIsUp()) {
+                MineProbability probability = ComputeMineProbability(board_, mine_count_, timer);
+                if (probability.success) {
+                    for (auto [row, column]: probability.safe_positions) {
+                        deductions_.emplace_back(board_.Index(row, column), 0);
+                    }
+                    for (auto [row, column]: probability.mine_positions) {
+                        deductions_.emplace_back(board_.Index(row, column), 1);
+                    }
+                }
+            }
+            return ApplyDeductions();
+        }
+
+        // Solves until the board is solved, stuck or out of time. Returns whether the board is solved.
+        bool Solve(Timer& timer) {
+            while (!timer.TimeIsUp()) {
+                if (Solved()) {
+                    if (kPrintDebugInfo) {
+                        std::clog << "Solved!" << std::endl;
+                        statistics_.Print(std::clog);
+                    }
+                    return true;
+                }
+                if (kPrintDebugInfo) {
+                    board_.Print();
+                }
+                if (!Step(timer)) {
+                    return false;
+                }
+            }
+            if (kPrintDebugInfo) {
+                std::clog << "Solvable Timeout!" << std::endl;
+                statistics_.Print(std::clog);
+            }
+            return false;
+        }
+    };
+
+    bool Solvable(const Board& board, Timer& timer, const SolveOptions& options = {}) {
+        if (kPrintDebugInfo) {
+            std::clog << "\nSolvable?" << std::endl;
+            board.Print();
+            board.PrintAll();
+            std::clog << std::endl;
+        }
+
+        Solver solver(board, options);
+        return solver.Solve(timer);
+    }
+
+    bool Solvable(const Board& board, int time_limit_milliseconds = 1000) {
+        Timer timer(time_limit_milliseconds);
+        return Solvable(board, timer);
+    }
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,351 @@
+#ifndef MINEALGO_MS_THREAD_POOL_H_
+#define MINEALGO_MS_THREAD_POOL_H_
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "ms_lib.h"
+
+namespace ms_algo {
+    using std::vector;
+
+    /**
+        A work-stealing pool. Each worker has its own deque: it pushes and pops its own tasks at the back,
+        and when empty takes tasks submitted from outside the pool, then steals from the front of the others.
+        Workers are started on the first submission, and a pool shut down starts again on the next one.
+        Workers waiting for a task through Wait() run queued tasks meanwhile, so a task may wait for the
+        tasks it submits without tying up a worker. Other threads only block there; to run its own tasks while
+        waiting, a caller submits them through a TaskGroup.
+    */
+    class ThreadPool {
+    private:
+        using Task = std::function<void()>;
+
+        struct WorkerQueue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        int thread_count_;
+        bool pin_threads_;
+
+        using WorkerQueues = vector<std::unique_ptr<WorkerQueue>>;
+
+        vector<std::thread> threads_;
+        // Replaced as a whole on each start, so that a thread reading the old queues keeps them alive.
+        std::shared_ptr<const WorkerQueues> queues_;
+
+        // Tasks submitted from threads outside the pool.
+        std::deque<Task> injected_;
+
+        // Guards `injected_`, `queues_`, starting and stopping. Idle workers sleep on `task_ready_`.
+        std::mutex mutex_;
+        std::condition_variable task_ready_;
+        bool started_ = false;
+        bool stopping_ = false;
+
+        // The number of queued tasks, in any queue.
+        std::atomic<int> pending_{0};
+
+        // The pool, index and queue of the worker running on the current thread, if any.
+        struct WorkerIdentity {
+            const ThreadPool* pool = nullptr;
+            int index = -1;
+            WorkerQueue* queue = nullptr;
+        };
+
+        static WorkerIdentity& CurrentWorker() {
+            static thread_local WorkerIdentity identity;
+            return identity;
+        }
+
+        int CurrentWorkerIndex() const {
+            const WorkerIdentity& identity = CurrentWorker();
+            return identity.pool == this ? identity.index : -1;
+        }
+
+        static bool PopBack(WorkerQueue& queue, Task& task) {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                return false;
+            }
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+
+        static bool PopFront(WorkerQueue& queue, Task& task) {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                return false;
+            }
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+
+        // Takes a task for worker `index` (-1 for other threads): its own newest task, else the oldest injected
+        // one, else the oldest task of another worker.
+        bool TakeTask(int index, Task& task) {
+            if (pending_ == 0) {
+                return false;
+            }
+            if (index != -1 && PopBack(*CurrentWorker().queue, task)) {
+                --pending_;
+                return true;
+            }
+            std::shared_ptr<const WorkerQueues> queues;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!injected_.empty()) {
+                    task = std::move(injected_.front());
+                    injected_.pop_front();
+                    --pending_;
+                    return true;
+                }
+                queues = queues_;
+            }
+            int queue_count = queues ? queues->size() : 0;
+            for (int offset = 1; offset <= queue_count; ++offset) {
+                int victim = (index + offset + queue_count) % queue_count;
+                if (victim != index && PopFront(*(*queues)[victim], task)) {
+                    --pending_;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void Work(int index, std::shared_ptr<const WorkerQueues> queues) {
+            CurrentWorker() = {this, index, (*queues)[index].get()};
+            if (pin_threads_) {
+                PinCurrentThread(index);
+            }
+            Task task;
+            while (true) {
+                if (TakeTask(index, task)) {
+                    task();
+                    task = nullptr;
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(mutex_);
+                task_ready_.wait(lock, [this] {
+                    return stopping_ || pending_ > 0;
+                });
+                if (stopping_ && pending_ == 0) {
+                    return;
+                }
+            }
+        }
+
+        // Binds the current thread to one CPU. Only supported on Linux; elsewhere threads are left to the scheduler.
+        static void PinCurrentThread(int index) {
+#ifdef __linux__
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(index % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+            pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#else
+            (void)index;
+#endif
+        }
+
+        // Starts the workers if they are not running. Requires `mutex_`.
+        void StartLocked() {
+            if (started_) {
+                return;
+            }
+            started_ = true;
+            auto queues = std::make_shared<WorkerQueues>();
+            for (int index = 0; index < thread_count_; ++index) {
+                queues->push_back(std::make_unique<WorkerQueue>());
+            }
+            queues_ = queues;
+            for (int index = 0; index < thread_count_; ++index) {
+                threads_.emplace_back(&ThreadPool::Work, this, index, queues_);
+            }
+        }
+
+    public:
+        // Prepares a pool of `thread_count` workers, optionally pinned to CPUs. No thread starts before the first task.
+        explicit ThreadPool(int thread_count = kMaxThreadCount, bool pin_threads = false)
+            : thread_count_(std::max(1, thread_count)), pin_threads_(pin_threads) {}
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ~ThreadPool() {
+            Shutdown();
+        }
+
+        int thread_count() const {
+            return thread_count_;
+        }
+
+        // Runs the tasks left, then joins the workers. The pool starts again on the next submission.
+        // Must not be called from a worker of this pool.
+        void Shutdown() {
+            assert(CurrentWorkerIndex() == -1);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!started_) {
+                    return;
+                }
+                stopping_ = true;
+            }
+            task_ready_.notify_all();
+            for (auto& thread: threads_) {
+                thread.join();
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            threads_.clear();
+            started_ = false;
+            stopping_ = false;
+        }
+
+        // Shuts the pool down and changes its size and affinity for the next start.
+        void Configure(int thread_count, bool pin_threads = false) {
+            Shutdown();
+            std::lock_guard<std::mutex> lock(mutex_);
+            thread_count_ = std::max(1, thread_count);
+            pin_threads_ = pin_threads;
+        }
+
+        // Queues a task: on the current worker's own deque when called from a worker, otherwise on the shared one.
+        void Execute(Task task) {
+            if (CurrentWorkerIndex() != -1) {
+                WorkerQueue& queue = *CurrentWorker().queue;
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.tasks.push_back(std::move(task));
+                ++pending_;
+            } else {
+                std::lock_guard<std::mutex> lock(mutex_);
+                StartLocked();
+                injected_.push_back(std::move(task));
+                ++pending_;
+            }
+            // Taking the lock orders the notification after a sleeping worker's last check of `pending_`.
+            { std::lock_guard<std::mutex> lock(mutex_); }
+            task_ready_.notify_one();
+        }
+
+        // Queues a function and returns the future of its result.
+        template<class Function>
+        std::future<std::invoke_result_t<Function>> Submit(Function&& function) {
+            using Result = std::invoke_result_t<Function>;
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+            std::future<Result> future = task->get_future();
+            Execute([task] {
+                (*task)();
+            });
+            return future;
+        }
+
+        // Runs one queued task on the current thread. Returns whether there was one.
+        bool RunPendingTask() {
+            Task task;
+            if (!TakeTask(CurrentWorkerIndex(), task)) {
+                return false;
+            }
+            task();
+            return true;
+        }
+
+        // Waits for a future. A worker of this pool runs queued tasks meanwhile, so that nested waits cannot use up
+        // the workers. Other threads just block: a queued task may be unrelated and run far longer than the wait.
+        template<class T>
+        void Wait(const std::future<T>& future) {
+            if (CurrentWorkerIndex() == -1) {
+                future.wait();
+                return;
+            }
+            while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                if (!RunPendingTask()) {
+                    future.wait_for(std::chrono::microseconds(100));
+                }
+            }
+        }
+    };
+
+    /**
+        Tasks of one caller on a pool. Wait() first runs, on the waiting thread, the tasks of the group no worker has
+        started yet, then blocks for the others. A caller thus never waits behind a busy pool for its own tasks, and
+        never runs anyone else's. Tasks still queued once the group has run them are skipped by the workers.
+    */
+    class TaskGroup {
+    private:
+        // A task run by whichever thread claims it first.
+        struct Entry {
+            std::atomic<bool> claimed{false};
+            std::function<void()> function;
+
+            void Run() {
+                if (!claimed.exchange(true)) {
+                    function();
+                }
+            }
+        };
+
+        ThreadPool& pool_;
+        vector<std::shared_ptr<Entry>> entries_;
+
+    public:
+        explicit TaskGroup(ThreadPool& pool) : pool_(pool) {}
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        // Queues a function on the pool and returns the future of its result.
+        template<class Function>
+        std::future<std::invoke_result_t<Function>> Submit(Function&& function) {
+            using Result = std::invoke_result_t<Function>;
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+            std::future<Result> future = task->get_future();
+            auto entry = std::make_shared<Entry>();
+            entry->function = [task] {
+                (*task)();
+            };
+            entries_.push_back(entry);
+            pool_.Execute([entry] {
+                entry->Run();
+            });
+            return future;
+        }
+
+        // Waits for the future of a task of this group, running the unstarted tasks of the group meanwhile.
+        template<class T>
+        void Wait(const std::future<T>& future) {
+            for (const auto& entry: entries_) {
+                if (future.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                    return;
+                }
+                entry->Run();
+            }
+            future.wait();
+        }
+    };
+
+    // The pool shared by the library. Its workers start on the first task; call Configure() before to change them.
+    ThreadPool& SharedThreadPool() {
+        static ThreadPool pool;
+        return pool;
+    }
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include <atomic>
 #include <cassert>
 
+#include "ms_instrument.h"
 #include "ms_lib.h"
 
 namespace ms_algo {
@@ -40,7 +41,10 @@ namespace ms_algo {
                 return true;
             }
             if (GetMilliseconds() - beginning_timestamp() >= time_limit_milliseconds()) {
-                Terminate();
+                // Counted once, by the thread that finds the time up first.
+                if (!time_is_up_.exchange(true)) {
+                    Count(Counter::kTimeouts);
+                }
                 return true;
             }
             return false;
@@ -0,0 +1,183 @@
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "src/minealgo.h"
+
+/*
+Checks the bit-plane backend of ms_bitboard.h against the grid-by-grid code it stands for:
+
+- RefreshBitwise() against Board::Refresh(), with the mines read from the board or placed in the mine plane
+- BitBoard::FrontierMask() against the frontier scan of Divide()
+
+The widths cover rows of one word, rows ending inside a word, and rows of several words. Rows of 4 words or more also
+go through the AVX2 kernel when it is compiled in (MINEALGO_NATIVE); every other row goes through the portable one.
+*/
+
+using ms_algo::BitBoard;
+using ms_algo::Board;
+using ms_algo::GridState;
+using std::vector;
+
+const int kWidths[] = {1, 2, 7, 8, 9, 30, 63, 64, 65, 127, 128, 129, 255, 256, 257, 300};
+
+// A board with random mines and states, mine counts left at 0.
+Board RandomBoard(ms_algo::Xoshiro256& random, int row_count, int column_count) {
+	Board board(row_count, column_count);
+	int density = 1 + (int)random.Below(40);
+	for (int row = 1; row <= row_count; ++row) {
+		for (int column = 1; column <= column_count; ++column) {
+			ms_algo::Grid& grid = board.get_grid_ref(row, column);
+			grid.set_is_mine((int)random.Below(100) < density);
+			grid.set_state(GridState(random.Below(3)));
+		}
+	}
+	return board;
+}
+
+bool SameGrids(const Board& lhs, const Board& rhs) {
+	for (int row = 1; row <= lhs.row_count(); ++row) {
+		for (int column = 1; column <= lhs.column_count(); ++column) {
+			ms_algo::Grid a = lhs.get_grid(row, column), b = rhs.get_grid(row, column);
+			if (a.is_mine() != b.is_mine() || a.mine_count() != b.mine_count() || a.state() != b.state()) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void TestWordPacking() {
+	for (uint64_t bits = 0; bits < 256; ++bits) {
+		uint64_t bytes = ms_algo::SpreadLowBits(bits);
+		for (int index = 0; index < 8; ++index) {
+			assert((bytes >> (index * 8) & 0xff) == (bits >> index & 1));
+		}
+		// Only the lowest bit of each byte is gathered.
+		assert(ms_algo::GatherLowBits(bytes | 0xfefefefefefefefe) == bits);
+	}
+}
+
+void TestRefresh() {
+	ms_algo::Xoshiro256 random(3);
+	int checked_count = 0;
+	for (int width: kWidths) {
+		for (int round = 0; round < 12; ++round) {
+			int row_count = 1 + (int)random.Below(round < 4 ? 3 : 70);
+			Board board = RandomBoard(random, row_count, width);
+			Board expected = board;
+			expected.Refresh();
+
+			// Counts over stale ones, as a board reused between attempts has.
+			Board bitwise = board;
+			bitwise.get_grid_ref(1, 1).set_mine_count(8);
+			ms_algo::RefreshBitwise(bitwise);
+			assert(SameGrids(bitwise, expected));
+
+			// The mine plane set grid by grid, as PlaceRandomMines() does.
+			BitBoard mines(row_count, width);
+			Board placed = board;
+			for (int row = 1; row <= row_count; ++row) {
+				for (int column = 1; column <= width; ++column) {
+					if (board.get_grid(row, column).is_mine()) {
+						mines.set_is_mine(row, column);
+					}
+				}
+			}
+			ms_algo::RefreshBitwise(placed, mines);
+			assert(SameGrids(placed, expected));
+			for (int row = 1; row <= row_count; ++row) {
+				for (int column = 1; column <= width; ++column) {
+					assert(mines.mine_count(row, column) == expected.get_grid(row, column).mine_count());
+				}
+			}
+			++checked_count;
+		}
+	}
+
+	// The mines placed for an attempt land in the board and its mine plane alike, over the mines of the initial board.
+	ms_algo::AttemptMines attempt_mines;
+	for (int round = 0; round < 20; ++round) {
+		int row_count = 1 + (int)random.Below(40), column_count = kWidths[random.Below(std::size(kWidths))];
+		Board initial = RandomBoard(random, row_count, column_count);
+		vector<std::pair<int, int>> grids;
+		for (int row = 1; row <= row_count; ++row) {
+			for (int column = 1; column <= column_count; ++column) {
+				if (!initial.get_grid(row, column).is_mine()) {
+					grids.emplace_back(row, column);
+				}
+			}
+		}
+		attempt_mines.Load(initial);
+		for (int attempt = 0; attempt < 3; ++attempt) {
+			Board board = initial;
+			vector<std::pair<int, int>> shuffled = grids;
+			ms_algo::BitBoard* mines = attempt_mines.Reset();
+			ms_algo::PlaceRandomMines(board, shuffled, (int)random.Below(grids.size() + 1), random(), mines);
+			ms_algo::RefreshMineCounts(board, mines);
+			Board expected = board;
+			expected.Refresh();
+			assert(SameGrids(board, expected));
+		}
+	}
+	std::cout << "refresh: " << checked_count << " boards" << std::endl;
+}
+
+void TestFrontier() {
+	ms_algo::Xoshiro256 random(4);
+	BitBoard bit_board;
+	vector<uint64_t> frontier;
+	int checked_count = 0;
+	for (int width: kWidths) {
+		for (int round = 0; round < 12; ++round) {
+			int row_count = 1 + (int)random.Below(round < 4 ? 3 : 70);
+			Board board = RandomBoard(random, row_count, width);
+			auto states = board.GetSituation();
+			bit_board.Assign(row_count, width, states);
+			bit_board.FrontierMask(frontier);
+
+			// As the grid-by-grid path of Divide(): opened grids with an unknown neighbour.
+			vector<std::pair<int, int>> expected, found;
+			for (int row = 1; row <= row_count; ++row) {
+				for (int column = 1; column <= width; ++column) {
+					if (states[row][column].first != GridState::kOpened) {
+						continue;
+					}
+					for (int index = 0; index < 8; ++index) {
+						int next_row = row + ms_algo::kRowOffset[index], next_column = column + ms_algo::kColumnOffset[index];
+						if (ms_algo::Inside(next_row, next_column, row_count, width) && states[next_row][next_column].first == GridState::kUnknown) {
+							expected.emplace_back(row, column);
+							break;
+						}
+					}
+				}
+			}
+			bit_board.ForEach(frontier, [&](int row, int column) {
+				found.emplace_back(row, column);
+			});
+			assert(found == expected);
+
+			// Loading the whole board gives the same states.
+			BitBoard loaded;
+			loaded.Assign(board);
+			loaded.FrontierMask(frontier);
+			found.clear();
+			loaded.ForEach(frontier, [&](int row, int column) {
+				found.emplace_back(row, column);
+			});
+			assert(found == expected);
+			++checked_count;
+		}
+	}
+	std::cout << "frontier: " << checked_count << " boards" << std::endl;
+}
+
+int main() {
+	TestWordPacking();
+	TestRefresh();
+	TestFrontier();
+	return 0;
+}
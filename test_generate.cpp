@@ -0,0 +1,338 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/minealgo.h"
+
+/*
+Checks what generation builds on:
+
+- seeded replay through Board::seed()
+- BoundedQueue
+- BoardPool watermarks and starting positions served by symmetry
+- the board encoding and the corpus files
+*/
+
+using ms_algo::Board;
+using ms_algo::GenerateSpec;
+using ms_algo::GenerateType;
+using std::vector;
+
+bool SameBoard(const Board& lhs, const Board& rhs) {
+	if (lhs.row_count() != rhs.row_count() || lhs.column_count() != rhs.column_count()) {
+		return false;
+	}
+	for (int row = 1; row <= lhs.row_count(); ++row) {
+		for (int column = 1; column <= lhs.column_count(); ++column) {
+			ms_algo::Grid a = lhs.get_grid(row, column), b = rhs.get_grid(row, column);
+			if (a.is_mine() != b.is_mine() || a.mine_count() != b.mine_count() || a.state() != b.state()) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// Whether every mine count agrees with the mines.
+bool CountsAgree(const Board& board) {
+	Board refreshed = board;
+	refreshed.Refresh();
+	return SameBoard(board, refreshed);
+}
+
+// Waits up to ten seconds for a condition.
+template<class Condition>
+bool WaitFor(Condition condition) {
+	for (int round = 0; round < 10000; ++round) {
+		if (condition()) {
+			return true;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return condition();
+}
+
+void TestSeedReplay() {
+	for (GenerateType type: {GenerateType::kNormal, GenerateType::kSolvable}) {
+		for (int thread_count: {1, 3}) {
+			auto [found, board] = ms_algo::Generate(9, 9, 5, 5, type, 5000, thread_count, 10);
+			assert(found && board.seed() != 0);
+			auto [found_again, replayed] = ms_algo::Generate(9, 9, 5, 5, type, 5000, thread_count, 10, board.seed());
+			assert(found_again && replayed.seed() == board.seed());
+			assert(SameBoard(board, replayed));
+		}
+	}
+	auto [found, board] = ms_algo::Generate(9, 9, 5, 5, GenerateType::kNormal, 1000, 1, 10, 42);
+	assert(found && board.seed() == 42);
+	auto [found_other, other] = ms_algo::Generate(9, 9, 5, 5, GenerateType::kNormal, 1000, 1, 10, 43);
+	assert(found_other && !SameBoard(board, other));
+}
+
+void TestQueue() {
+	ms_algo::BoundedQueue<int> queue(3);
+	assert(queue.capacity() == 4);
+	for (int value = 0; value < 4; ++value) {
+		assert(queue.TryPush(int(value)));
+	}
+	assert(!queue.TryPush(4));
+	int value;
+	for (int expected = 0; expected < 4; ++expected) {
+		assert(queue.TryPop(value) && value == expected);
+	}
+	assert(!queue.TryPop(value));
+
+	queue.TryPush(7);
+	queue.Close();
+	assert(queue.closed() && !queue.Push(8));
+	assert(queue.Pop(value) && value == 7);
+	assert(!queue.Pop(value));
+
+	// Every value pushed by several producers is popped exactly once.
+	const int producer_count = 4, consumer_count = 4, per_producer = 20000;
+	ms_algo::BoundedQueue<int> shared(64);
+	std::atomic<int64_t> sum{0};
+	std::atomic<int> popped{0};
+	vector<std::thread> threads;
+	for (int producer = 0; producer < producer_count; ++producer) {
+		threads.emplace_back([&shared, producer] {
+			for (int index = 1; index <= per_producer; ++index) {
+				bool pushed = shared.Push(producer * per_producer + index);
+				assert(pushed);
+				(void)pushed;
+			}
+		});
+	}
+	for (int consumer = 0; consumer < consumer_count; ++consumer) {
+		threads.emplace_back([&] {
+			int taken;
+			while (shared.Pop(taken)) {
+				sum += taken;
+				++popped;
+			}
+		});
+	}
+	for (int producer = 0; producer < producer_count; ++producer) {
+		threads[producer].join();
+	}
+	shared.Close();
+	for (size_t index = producer_count; index < threads.size(); ++index) {
+		threads[index].join();
+	}
+	int64_t count = (int64_t)producer_count * per_producer;
+	assert(popped == count && sum == count * (count + 1) / 2);
+}
+
+void TestBoardPool() {
+	ms_algo::PoolOptions options;
+	options.low_watermark = 2;
+	options.high_watermark = 4;
+	ms_algo::BoardPool pool(options);
+
+	GenerateSpec spec;
+	spec.row_count = 8;
+	spec.column_count = 12;
+	spec.start_row = 1;
+	spec.start_column = 1;
+	spec.random_mine_count = 12;
+	spec.type = GenerateType::kSolvable;
+	pool.AddPreset(spec);
+	assert(WaitFor([&] { return pool.statistics().stored_count == 4; }));
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	assert(pool.statistics().stored_count == 4);
+
+	// The same start serves itself as is; the opposite corner is a rotation of it on a non-square board.
+	GenerateSpec request = spec;
+	Board board;
+	assert(pool.Take(request, board));
+	assert(board.seed() != 0 && !board.get_grid(1, 1).is_mine() && CountsAgree(board));
+	request.start_row = 8;
+	request.start_column = 12;
+	assert(pool.Take(request, board));
+	assert(board.seed() == 0 && !board.get_grid(8, 12).is_mine() && board.get_grid(8, 12).IsOpened() && CountsAgree(board));
+	assert(ms_algo::Solvable(board));
+
+	// A transposed start is not a symmetry of a non-square board, and another mine count is another preset.
+	request.start_row = 1;
+	request.start_column = 8;
+	assert(!pool.Take(request, board));
+	request = spec;
+	request.random_mine_count = 13;
+	assert(!pool.Take(request, board));
+
+	// Falling below the low watermark refills up to the high one.
+	assert(pool.Take(spec, board));
+	assert(WaitFor([&] { return pool.statistics().refill_count == 1; }));
+	ms_algo::PoolStatistics statistics = pool.statistics();
+	assert(statistics.stored_count == 4 && statistics.hit_count == 3 && statistics.miss_count == 2);
+	pool.Shutdown();
+}
+
+void TestEncoding() {
+	auto [found, board] = ms_algo::Generate(7, 11, 4, 6, GenerateType::kSolvable, 5000, 1, 15);
+	assert(found);
+	board.Open(4, 6);
+	board.get_grid_ref(1, 1).set_state(board.get_grid(1, 1).is_mine() ? ms_algo::GridState::kFlaged : ms_algo::GridState::kOpened);
+	GenerateSpec spec;
+	spec.row_count = 7;
+	spec.column_count = 11;
+	spec.start_row = 4;
+	spec.start_column = 6;
+	spec.type = GenerateType::kSolvable;
+
+	for (bool with_state: {true, false}) {
+		vector<uint8_t> encoding;
+		ms_algo::EncodeBoard(board, spec, with_state, encoding);
+		assert(encoding.size() == ms_algo::EncodedBoardSize(7, 11, with_state));
+		Board decoded;
+		GenerateSpec decoded_spec;
+		assert(ms_algo::DecodeBoard(encoding.data(), encoding.size(), decoded, &decoded_spec));
+		assert(decoded.seed() == board.seed());
+		assert(decoded_spec.start_row == 4 && decoded_spec.start_column == 6 && decoded_spec.type == GenerateType::kSolvable);
+		assert(decoded_spec.random_mine_count == 15);
+		if (with_state) {
+			assert(SameBoard(decoded, board));
+		} else {
+			Board mines_only = board;
+			for (int row = 1; row <= 7; ++row) {
+				for (int column = 1; column <= 11; ++column) {
+					mines_only.get_grid_ref(row, column).set_state(ms_algo::GridState::kUnknown);
+				}
+			}
+			assert(SameBoard(decoded, mines_only));
+		}
+
+		// Cut short, too long, or with unknown flags, an encoding is rejected and the board left alone.
+		Board untouched = decoded;
+		assert(!ms_algo::DecodeBoard(encoding.data(), encoding.size() - 1, decoded));
+		encoding.push_back(0);
+		assert(!ms_algo::DecodeBoard(encoding.data(), encoding.size(), decoded));
+		encoding.pop_back();
+		encoding[offsetof(ms_algo::BoardRecordHeader, flags)] |= 0x80;
+		assert(!ms_algo::DecodeBoard(encoding.data(), encoding.size(), decoded));
+		assert(SameBoard(decoded, untouched));
+	}
+}
+
+// Overwrites the offset of index entry `index` in a corpus.
+void DamageOffset(const std::string& path, size_t index, uint64_t offset) {
+	std::fstream file(ms_algo::CorpusIndexPath(path), std::ios::binary | std::ios::in | std::ios::out);
+	file.seekp(sizeof(ms_algo::CorpusFileHeader) + index * sizeof(ms_algo::CorpusIndexEntry) + offsetof(ms_algo::CorpusIndexEntry, offset));
+	file.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+}
+
+void TestCorpus() {
+	namespace fs = std::filesystem;
+	fs::path directory = fs::temp_directory_path() / ("minealgo_test_" + std::to_string(ms_algo::NewSeed()));
+	fs::create_directories(directory);
+	std::string path = (directory / "boards").string();
+	std::string index_path = ms_algo::CorpusIndexPath(path);
+
+	vector<Board> boards;
+	vector<GenerateSpec> specs;
+	{
+		ms_algo::CorpusWriter writer(path);
+		assert(writer.is_open() && writer.size() == 0);
+		for (int index = 0; index < 5; ++index) {
+			GenerateSpec spec;
+			spec.row_count = 6 + index;
+			spec.column_count = 9;
+			spec.random_mine_count = 8;
+			spec.type = GenerateType::kNormal;
+			auto [found, board] = ms_algo::Generate(spec.row_count, spec.column_count, 1, 1, spec.type, 1000, 1, spec.random_mine_count);
+			assert(found);
+			assert(writer.Append(board, spec, index % 2 == 0));
+			boards.push_back(board);
+			specs.push_back(spec);
+		}
+		assert(writer.size() == 5);
+	}
+
+	auto check = [&](const ms_algo::CorpusReader& reader, size_t index) {
+		ms_algo::BoardView view = reader[index];
+		assert(view.valid() && view.seed() == boards[index].seed() && view.row_count() == specs[index].row_count);
+		Board decoded;
+		view.Decode(decoded);
+		for (int row = 1; row <= decoded.row_count(); ++row) {
+			for (int column = 1; column <= decoded.column_count(); ++column) {
+				assert(decoded.get_grid(row, column).is_mine() == boards[index].get_grid(row, column).is_mine());
+				assert(view.is_mine(row, column) == boards[index].get_grid(row, column).is_mine());
+			}
+		}
+		assert(CountsAgree(decoded));
+	};
+	{
+		ms_algo::CorpusReader reader(path);
+		assert(reader.size() == 5);
+		for (size_t index = 0; index < 5; ++index) {
+			check(reader, index);
+		}
+	}
+
+	// An index entry cut short is not counted, and the writer trims it before appending.
+	uint64_t index_size = fs::file_size(index_path);
+	{
+		std::ofstream index(index_path, std::ios::binary | std::ios::app);
+		index.write("partial", 7);
+	}
+	{
+		ms_algo::CorpusReader reader(path);
+		assert(reader.size() == 5);
+	}
+	{
+		ms_algo::CorpusWriter writer(path);
+		assert(writer.is_open() && writer.size() == 5);
+		assert(fs::file_size(index_path) == index_size);
+		assert(writer.Append(boards[0], specs[0]));
+		boards.push_back(boards[0]);
+		specs.push_back(specs[0]);
+	}
+	{
+		ms_algo::CorpusReader reader(path);
+		assert(reader.size() == 6);
+		check(reader, 5);
+	}
+
+	// A damaged offset gives an invalid view of that board only.
+	DamageOffset(path, 2, uint64_t(1) << 40);
+	DamageOffset(path, 3, 0);
+	DamageOffset(path, 4, fs::file_size(path) - 1);
+	{
+		ms_algo::CorpusReader reader(path);
+		assert(reader.size() == 6);
+		assert(!reader[2].valid() && !reader[3].valid() && !reader[4].valid());
+		check(reader, 0);
+		check(reader, 1);
+		check(reader, 5);
+	}
+
+	// Files that are not a corpus are refused.
+	{
+		std::ofstream data(path, std::ios::binary | std::ios::in | std::ios::out);
+		data.write("NOTBOARD", 8);
+	}
+	assert(!ms_algo::CorpusReader().Open(path));
+	assert(!ms_algo::CorpusWriter().Open(path));
+	// So are appends to a writer that is not open, as one is after a failed write.
+	assert(!ms_algo::CorpusWriter().Append(boards[0], specs[0]));
+
+	fs::remove_all(directory);
+}
+
+int main() {
+	TestSeedReplay();
+	TestQueue();
+	TestBoardPool();
+	TestEncoding();
+	TestCorpus();
+	std::cout << "generate: all checks passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,263 @@
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "src/minealgo.h"
+
+/*
+Checks the solving engines against each other and against brute force:
+
+- dense and sparse GaussianElimination()
+- EnumerateMine(), BacktrackMine() and CountMineByFrontier()
+- ComputeMineProbability()
+*/
+
+using ms_algo::GridState;
+using ms_algo::Matrix;
+using ms_algo::SparseMatrix;
+using std::vector;
+
+using Situation = Matrix<std::pair<GridState, int>>;
+
+// A random situation: `mine_count` mines, and each safe grid opened with probability `open_rate`.
+// Returns the situation, and fills `mines` with the layout it comes from.
+Situation RandomSituation(ms_algo::Xoshiro256& random, int row_count, int column_count, int mine_count, double open_rate, Matrix<bool>& mines) {
+	mines.assign(row_count + 1, vector<bool>(column_count + 1, false));
+	for (int placed = 0; placed < mine_count;) {
+		int row = 1 + (int)(random() % row_count), column = 1 + (int)(random() % column_count);
+		if (!mines[row][column]) {
+			mines[row][column] = true;
+			++placed;
+		}
+	}
+	Situation states(row_count + 1, vector<std::pair<GridState, int>>(column_count + 1, {GridState::kUnknown, 0}));
+	for (int row = 1; row <= row_count; ++row) {
+		for (int column = 1; column <= column_count; ++column) {
+			if (mines[row][column] || (double)(random() % 1000) >= open_rate * 1000) {
+				continue;
+			}
+			int count = 0;
+			for (int index = 0; index < 8; ++index) {
+				int next_row = row + ms_algo::kRowOffset[index], next_column = column + ms_algo::kColumnOffset[index];
+				count += ms_algo::Inside(next_row, next_column, row_count, column_count) && mines[next_row][next_column];
+			}
+			states[row][column] = {GridState::kOpened, count};
+		}
+	}
+	return states;
+}
+
+// Counts the solutions of a region's constraints by trying every assignment.
+std::pair<int64_t, vector<int64_t>> BruteForce(const SparseMatrix& constraints, int variable_count) {
+	std::pair<int64_t, vector<int64_t>> result(0, vector<int64_t>(variable_count, 0));
+	for (uint32_t mask = 0; mask < (uint32_t(1) << variable_count); ++mask) {
+		bool legal = true;
+		for (const auto& row: constraints) {
+			int sum = 0;
+			for (auto [variable, coefficient]: row.entries) {
+				sum += coefficient * (int)(mask >> variable & 1);
+			}
+			legal = legal && sum == row.value;
+		}
+		if (!legal) {
+			continue;
+		}
+		++result.first;
+		for (int variable = 0; variable < variable_count; ++variable) {
+			result.second[variable] += mask >> variable & 1;
+		}
+	}
+	return result;
+}
+
+Matrix<int> ToDense(const SparseMatrix& constraints, int variable_count) {
+	Matrix<int> dense(constraints.size(), vector<int>(variable_count + 1, 0));
+	for (size_t row = 0; row < constraints.size(); ++row) {
+		for (auto [variable, coefficient]: constraints[row].entries) {
+			dense[row][variable] = coefficient;
+		}
+		dense[row][variable_count] = constraints[row].value;
+	}
+	return dense;
+}
+
+void TestEngines() {
+	ms_algo::Xoshiro256 random(1);
+	int checked_count = 0, wide_count = 0;
+	for (int round = 0; round < 400; ++round) {
+		Matrix<bool> mines;
+		Situation states = RandomSituation(random, 8, 8, 10 + round % 8, 0.35, mines);
+		for (const ms_algo::Region& region: ms_algo::Divide(8, 8, states)) {
+			int variable_count = region.first.size();
+			ms_algo::Timer timer(60 * 1000);
+
+			auto [frontier_count, frontier_mines] = ms_algo::CountMineByFrontier(region.second, variable_count, timer);
+			auto [backtrack_count, backtrack_mines] = ms_algo::BacktrackMine(region.second, variable_count, timer);
+			assert(frontier_count == ms_algo::BigUnsigned(backtrack_count));
+			for (int variable = 0; variable < variable_count; ++variable) {
+				assert(frontier_mines[variable] == ms_algo::BigUnsigned(backtrack_mines[variable]));
+			}
+			// The layout the situation comes from is one of the solutions.
+			assert(backtrack_count > 0);
+
+			SparseMatrix sparse = region.second;
+			Matrix<int> dense = ToDense(region.second, variable_count);
+			vector<std::pair<int, int>> sparse_solved, dense_solved;
+			assert(ms_algo::GaussianElimination(sparse, variable_count, sparse_solved));
+			assert(ms_algo::GaussianElimination(dense, dense_solved));
+			std::sort(sparse_solved.begin(), sparse_solved.end());
+			std::sort(dense_solved.begin(), dense_solved.end());
+			assert(sparse_solved == dense_solved);
+			assert(sparse.size() == dense.size());
+			for (auto [variable, type]: sparse_solved) {
+				assert(backtrack_mines[variable] == (type ? backtrack_count : 0));
+			}
+
+			if (variable_count - (int)sparse.size() <= 16) {
+				auto [sparse_count, sparse_mines] = ms_algo::EnumerateMine(sparse, variable_count, timer);
+				assert(sparse_count == backtrack_count && sparse_mines == backtrack_mines);
+			}
+
+			if (variable_count <= 20) {
+				auto [count, mine_counts] = BruteForce(region.second, variable_count);
+				assert(count == backtrack_count && mine_counts == backtrack_mines);
+				auto [dense_count, dense_mines] = ms_algo::EnumerateMine(dense, variable_count, timer);
+				assert(dense_count == count && dense_mines == mine_counts);
+				++checked_count;
+			} else {
+				++wide_count;
+			}
+		}
+	}
+	assert(checked_count >= 100 && wide_count >= 100);
+	std::cout << "engines: " << checked_count << " regions against brute force, " << wide_count << " wider ones" << std::endl;
+}
+
+void TestInconsistent() {
+	// x0 = 2.
+	SparseMatrix out_of_range(1);
+	out_of_range[0].entries = {{0, 1}};
+	out_of_range[0].value = 2;
+	vector<std::pair<int, int>> solved;
+	assert(!ms_algo::GaussianElimination(out_of_range, 1, solved) && solved.empty());
+
+	// x0 + x1 = 1 and x0 + x1 = 2.
+	SparseMatrix contradictory(2);
+	contradictory[0].entries = contradictory[1].entries = {{0, 1}, {1, 1}};
+	contradictory[0].value = 1;
+	contradictory[1].value = 2;
+	Matrix<int> dense = ToDense(contradictory, 2);
+	assert(!ms_algo::GaussianElimination(contradictory, 2, solved));
+	assert(!ms_algo::GaussianElimination(dense, solved));
+
+	// A 2 with a single unknown neighbour fails the step instead of aborting.
+	Situation states(2, vector<std::pair<GridState, int>>(3, {GridState::kUnknown, 0}));
+	states[1][1] = {GridState::kOpened, 2};
+	ms_algo::Timer timer(1000);
+	assert(!ms_algo::SolveOneStep(1, 2, states, timer));
+	assert(states[1][2].first == GridState::kUnknown);
+}
+
+void TestProbability() {
+	ms_algo::Xoshiro256 random(2);
+	int checked_count = 0;
+	for (int round = 0; round < 300; ++round) {
+		const int row_count = 4, column_count = 5, mine_count = 3 + round % 5;
+		Matrix<bool> mines;
+		Situation states = RandomSituation(random, row_count, column_count, mine_count, 0.5, mines);
+		int flaged_count = 0;
+		vector<std::pair<int, int>> unknowns;
+		for (int row = 1; row <= row_count; ++row) {
+			for (int column = 1; column <= column_count; ++column) {
+				if (states[row][column].first != GridState::kUnknown) {
+					continue;
+				}
+				if (mines[row][column] && random() % 4 == 0) {
+					states[row][column].first = GridState::kFlaged;
+					++flaged_count;
+				} else {
+					unknowns.emplace_back(row, column);
+				}
+			}
+		}
+
+		// Every layout of the unknown grids with the remaining mines which agrees with the numbers.
+		int64_t layout_count = 0;
+		vector<int64_t> mine_layouts(unknowns.size(), 0);
+		for (uint32_t mask = 0; mask < (uint32_t(1) << unknowns.size()); ++mask) {
+			if (ms_algo::PopCount(mask) != mine_count - flaged_count) {
+				continue;
+			}
+			Matrix<bool> layout(row_count + 1, vector<bool>(column_count + 1, false));
+			for (size_t index = 0; index < unknowns.size(); ++index) {
+				layout[unknowns[index].first][unknowns[index].second] = mask >> index & 1;
+			}
+			bool legal = true;
+			for (int row = 1; row <= row_count && legal; ++row) {
+				for (int column = 1; column <= column_count && legal; ++column) {
+					if (states[row][column].first != GridState::kOpened) {
+						continue;
+					}
+					int count = 0;
+					for (int index = 0; index < 8; ++index) {
+						int next_row = row + ms_algo::kRowOffset[index], next_column = column + ms_algo::kColumnOffset[index];
+						if (ms_algo::Inside(next_row, next_column, row_count, column_count)) {
+							count += layout[next_row][next_column] || states[next_row][next_column].first == GridState::kFlaged;
+						}
+					}
+					legal = count == states[row][column].second;
+				}
+			}
+			if (!legal) {
+				continue;
+			}
+			++layout_count;
+			for (size_t index = 0; index < unknowns.size(); ++index) {
+				mine_layouts[index] += mask >> index & 1;
+			}
+		}
+		assert(layout_count > 0);
+
+		ms_algo::Timer timer(60 * 1000);
+		ms_algo::MineProbability probability = ms_algo::ComputeMineProbability(row_count, column_count, states, mine_count, timer);
+		assert(probability.success);
+		assert(probability.layout_count == ms_algo::BigUnsigned(layout_count));
+		size_t safe_count = 0, forced_count = 0;
+		for (size_t index = 0; index < unknowns.size(); ++index) {
+			auto [row, column] = unknowns[index];
+			assert(std::abs(probability.probabilities[row][column] - (double)mine_layouts[index] / layout_count) < 1e-9);
+			safe_count += mine_layouts[index] == 0;
+			forced_count += mine_layouts[index] == layout_count;
+		}
+		assert(probability.safe_positions.size() == safe_count);
+		assert(probability.mine_positions.size() == forced_count);
+		++checked_count;
+	}
+	std::cout << "probability: " << checked_count << " boards against brute force" << std::endl;
+}
+
+void TestDeepFrontier() {
+	// A checkerboard makes one region of every grid, which a recursive search would walk one frame per grid.
+	const int size = 300;
+	Situation states(size + 1, vector<std::pair<GridState, int>>(size + 1, {GridState::kUnknown, 0}));
+	for (int row = 1; row <= size; ++row) {
+		for (int column = 1; column <= size; ++column) {
+			if ((row + column) % 2 == 0) {
+				states[row][column] = {GridState::kOpened, 1};
+			}
+		}
+	}
+	vector<ms_algo::Region> regions = ms_algo::Divide(size, size, states);
+	assert(regions.size() == 1 && regions[0].first.size() == size * size / 2);
+}
+
+int main() {
+	TestEngines();
+	TestInconsistent();
+	TestProbability();
+	TestDeepFrontier();
+	return 0;
+}